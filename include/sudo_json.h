@@ -66,7 +66,9 @@ struct json_container {
 };
 
 sudo_dso_public bool sudo_json_init_v1(struct json_container *json, int indent, bool minimal, bool memfatal);
+sudo_dso_public bool sudo_json_init_v2(struct json_container *json, int indent, bool minimal, bool memfatal, unsigned int size_hint);
 #define sudo_json_init(_a, _b, _c, _d) sudo_json_init_v1((_a), (_b), (_c), (_d))
+#define sudo_json_initsz(_a, _b, _c, _d, _e) sudo_json_init_v2((_a), (_b), (_c), (_d), (_e))
 
 sudo_dso_public void sudo_json_free_v1(struct json_container *json);
 #define sudo_json_free(_a) sudo_json_free_v1((_a))
@@ -30,16 +30,20 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <netinet/in.h>
 
-#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <grp.h>
+#ifdef HAVE_LINUX_CLOSE_RANGE_H
+# include <linux/close_range.h>
+#endif
 #include <locale.h>
 #include <pwd.h>
 #include <signal.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -69,13 +73,42 @@
 #define	LL_EXIT_STR	"EXIT="
 #define	LL_SIGNAL_STR	"SIGNAL="
 
-#define IS_SESSID(s) ( \
-    isalnum((unsigned char)(s)[0]) && isalnum((unsigned char)(s)[1]) && \
-    (s)[2] == '/' && \
-    isalnum((unsigned char)(s)[3]) && isalnum((unsigned char)(s)[4]) && \
-    (s)[5] == '/' && \
-    isalnum((unsigned char)(s)[6]) && isalnum((unsigned char)(s)[7]) && \
-    (s)[8] == '\0')
+#define	LL_HOST_LEN	(sizeof(LL_HOST_STR) - 1)
+#define	LL_TTY_LEN	(sizeof(LL_TTY_STR) - 1)
+#define	LL_CHROOT_LEN	(sizeof(LL_CHROOT_STR) - 1)
+#define	LL_CWD_LEN	(sizeof(LL_CWD_STR) - 1)
+#define	LL_USER_LEN	(sizeof(LL_USER_STR) - 1)
+#define	LL_GROUP_LEN	(sizeof(LL_GROUP_STR) - 1)
+#define	LL_ENV_LEN	(sizeof(LL_ENV_STR) - 1)
+#define	LL_CMND_LEN	(sizeof(LL_CMND_STR) - 1)
+#define	LL_TSID_LEN	(sizeof(LL_TSID_STR) - 1)
+#define	LL_EXIT_LEN	(sizeof(LL_EXIT_STR) - 1)
+#define	LL_SIGNAL_LEN	(sizeof(LL_SIGNAL_STR) - 1)
+
+/*
+ * Returns true if the string is a sudoers-style session ID, i.e.
+ * XX/XX/XX where X is alphanumeric.  Session IDs are always ASCII so
+ * we use a branchless, locale-independent [0-9A-Za-z] test on the six
+ * ID bytes instead of isalnum().
+ */
+static bool
+is_sessid(const char *s)
+{
+    static const unsigned char idx[6] = { 0, 1, 3, 4, 6, 7 };
+    unsigned int bad = 0;
+    unsigned int i;
+
+    if (strlen(s) != 8 || s[2] != '/' || s[5] != '/')
+	return false;
+
+    for (i = 0; i < 6; i++) {
+	const unsigned char c = (unsigned char)s[idx[i]];
+	const unsigned int is_digit = (unsigned int)(c - '0') < 10;
+	const unsigned int is_alpha = (unsigned int)((c | 0x20) - 'a') < 26;
+	bad |= (is_digit | is_alpha) ^ 1;
+    }
+    return bad == 0;
+}
 
 struct eventlog_args {
     const char *reason;
@@ -83,42 +116,168 @@ struct eventlog_args {
     const struct timespec *event_time;
     eventlog_json_callback_t json_info_cb;
     void *json_info;
+    struct json_container shared_json;	/* record shared between sinks */
+    bool shared_json_valid;
+    const char *logline;		/* sudo-format line shared between sinks */
 };
 
 /*
- * Allocate and fill in a new logline.
+ * Reusable buffer for new_logline(), grown on demand and reused across
+ * calls.  The eventlog functions are not re-entrant so a single buffer
+ * is sufficient; the caller must use or copy the line before the next
+ * call to new_logline().
+ */
+static char *logbuf;
+static size_t logbuf_size;
+static size_t logbuf_used;	/* length of the last line built */
+
+/*
+ * Make sure logbuf is allocated and return a cursor to the start of it.
+ * Returns NULL if memory allocation fails.
+ */
+static char *
+logline_start(void)
+{
+    if (logbuf == NULL) {
+	if ((logbuf = malloc(1024)) == NULL)
+	    return NULL;
+	logbuf_size = 1024;
+    }
+    return logbuf;
+}
+
+/*
+ * Append the first n bytes of src at the logbuf cursor cur, doubling
+ * logbuf as needed.  Returns a pointer to the new end of the string or
+ * NULL if memory allocation fails.  A NULL cur is passed through so
+ * calls can be chained with a single check.
+ */
+static char *
+append(char *cur, const char *src, size_t n)
+{
+    size_t used;
+
+    if (cur == NULL)
+	return NULL;
+    used = (size_t)(cur - logbuf);
+    if (n + 1 > logbuf_size - used) {
+	size_t new_size = logbuf_size;
+	char *new_buf;
+
+	while (n + 1 > new_size - used)
+	    new_size *= 2;
+	if ((new_buf = realloc(logbuf, new_size)) == NULL)
+	    return NULL;
+	logbuf = new_buf;
+	logbuf_size = new_size;
+	cur = logbuf + used;
+    }
+    memcpy(cur, src, n);
+    return cur + n;
+}
+
+/*
+ * Format an int in base 10 without going through snprintf().
+ * The destination must be at least ((sizeof(int) * 8) + 2) / 3 + 2 bytes.
+ * Returns the number of characters written, not counting the NUL.
+ */
+static size_t
+format_int(char *dst, int v)
+{
+    char numbuf[(((sizeof(int) * 8) + 2) / 3) + 2];
+    char *cp = numbuf + sizeof(numbuf);
+    unsigned int uv = (unsigned int)v;
+    size_t len;
+
+    if (v < 0)
+	uv = 0U - uv;
+    do {
+	*--cp = (char)('0' + (uv % 10));
+	uv /= 10;
+    } while (uv != 0);
+    if (v < 0)
+	*--cp = '-';
+    len = (size_t)(numbuf + sizeof(numbuf) - cp);
+    memcpy(dst, cp, len);
+    dst[len] = '\0';
+    return len;
+}
+
+/*
+ * Format an I/O log offset as '@', the seconds in base 10 and up to
+ * two significant digits of the decimal part, without snprintf().
+ * The destination must be at least 24 bytes.
+ * Returns the number of characters written, not counting the NUL.
+ */
+static size_t
+format_offset(char *dst, const struct timespec *ts)
+{
+    char numbuf[(((sizeof(long long) * 8) + 2) / 3) + 2];
+    char *cp = numbuf + sizeof(numbuf);
+    long long secs = (long long)ts->tv_sec;
+    unsigned long long uv = (unsigned long long)secs;
+    size_t len = 0, numlen;
+
+    dst[len++] = '@';
+    if (secs < 0)
+	uv = 0ULL - uv;
+    do {
+	*--cp = (char)('0' + (uv % 10));
+	uv /= 10;
+    } while (uv != 0);
+    if (secs < 0)
+	*--cp = '-';
+    numlen = (size_t)(numbuf + sizeof(numbuf) - cp);
+    memcpy(dst + len, cp, numlen);
+    len += numlen;
+    if (ts->tv_nsec > 10000000) {
+	const long frac = ts->tv_nsec / 10000000;
+	dst[len++] = '.';
+	dst[len++] = (char)('0' + frac / 10);
+	dst[len++] = (char)('0' + frac % 10);
+    }
+    dst[len] = '\0';
+    return len;
+}
+
+/*
+ * Fill in a new logline in a single pass over the eventlog fields.
+ * Returns a pointer to a buffer owned by new_logline() that remains
+ * valid until the next call; the caller must not free it.
  */
 static char *
 new_logline(int event_type, int flags, struct eventlog_args *args,
     const struct eventlog *evlog)
 {
     const struct eventlog_config *evl_conf = eventlog_getconf();
-    char *line = NULL, *evstr = NULL;
+    char *cur;
     const char *iolog_file;
     const char *tty, *tsid = NULL;
     char exit_str[(((sizeof(int) * 8) + 2) / 3) + 2];
     char sessid[7], offsetstr[64] = "";
-    size_t len = 0;
+    size_t offset_len = 0, tty_len = 0;
     int i;
     debug_decl(new_logline, SUDO_DEBUG_UTIL);
 
     if (ISSET(flags, EVLOG_RAW) || evlog == NULL) {
-	if (args->reason != NULL) {
-	    if (args->errstr != NULL) {
-		if (asprintf(&line, "%s: %s", args->reason, args->errstr) == -1)
-		    goto oom;
-	    } else {
-		if ((line = strdup(args->reason)) == NULL)
-		    goto oom;
-	    }
+	if (args->reason == NULL)
+	    debug_return_str(NULL);
+	cur = append(logline_start(), args->reason, strlen(args->reason));
+	if (args->errstr != NULL) {
+	    cur = append(cur, ": ", 2);
+	    cur = append(cur, args->errstr, strlen(args->errstr));
 	}
-	debug_return_str(line);
+	if (cur == NULL)
+	    goto oom;
+	*cur = '\0';
+	logbuf_used = (size_t)(cur - logbuf);
+	debug_return_str(logbuf);
     }
 
     /* A TSID may be a sudoers-style session ID or a free-form string. */
     iolog_file = evlog->iolog_file;
     if (iolog_file != NULL) {
-	if (IS_SESSID(iolog_file)) {
+	if (is_sessid(iolog_file)) {
 	    sessid[0] = iolog_file[0];
 	    sessid[1] = iolog_file[1];
 	    sessid[2] = iolog_file[3];
@@ -132,218 +291,177 @@ new_logline(int event_type, int flags, struct eventlog_args *args,
 	}
 	if (sudo_timespecisset(&evlog->iolog_offset)) {
 	    /* Only write up to two significant digits for the decimal part. */
-	    if (evlog->iolog_offset.tv_nsec > 10000000) {
-		(void)snprintf(offsetstr, sizeof(offsetstr), "@%lld.%02ld",
-		    (long long)evlog->iolog_offset.tv_sec,
-		    evlog->iolog_offset.tv_nsec / 10000000);
-	    } else if (evlog->iolog_offset.tv_sec != 0) {
-		(void)snprintf(offsetstr, sizeof(offsetstr), "@%lld",
-		    (long long)evlog->iolog_offset.tv_sec);
-	    }
+	    if (evlog->iolog_offset.tv_nsec > 10000000 ||
+		    evlog->iolog_offset.tv_sec != 0)
+		offset_len = format_offset(offsetstr, &evlog->iolog_offset);
 	}
     }
 
     /* Sudo-format logs use the short form of the ttyname. */
     if ((tty = evlog->ttyname) != NULL) {
-	if (strncmp(tty, _PATH_DEV, sizeof(_PATH_DEV) - 1) == 0)
+	tty_len = strlen(tty);
+	if (tty_len >= sizeof(_PATH_DEV) - 1 &&
+		memcmp(tty, _PATH_DEV, sizeof(_PATH_DEV) - 1) == 0) {
 	    tty += sizeof(_PATH_DEV) - 1;
-    }
-
-    /*
-     * Compute line length
-     */
-    if (args->reason != NULL)
-	len += strlen(args->reason) + 3;
-    if (args->errstr != NULL)
-	len += strlen(args->errstr) + 3;
-    if (evlog->submithost != NULL && !evl_conf->omit_hostname)
-	len += sizeof(LL_HOST_STR) + 2 + strlen(evlog->submithost);
-    if (tty != NULL)
-	len += sizeof(LL_TTY_STR) + 2 + strlen(tty);
-    if (evlog->runchroot != NULL)
-	len += sizeof(LL_CHROOT_STR) + 2 + strlen(evlog->runchroot);
-    if (evlog->runcwd != NULL)
-	len += sizeof(LL_CWD_STR) + 2 + strlen(evlog->runcwd);
-    if (evlog->runuser != NULL)
-	len += sizeof(LL_USER_STR) + 2 + strlen(evlog->runuser);
-    if (evlog->rungroup != NULL)
-	len += sizeof(LL_GROUP_STR) + 2 + strlen(evlog->rungroup);
-    if (tsid != NULL) {
-	len += sizeof(LL_TSID_STR) + 2 + strlen(tsid) + strlen(offsetstr);
-    }
-    if (evlog->env_add != NULL) {
-	size_t evlen = 0;
-	char * const *ep;
-
-	for (ep = evlog->env_add; *ep != NULL; ep++)
-	    evlen += strlen(*ep) + 1;
-	if (evlen != 0) {
-	    if ((evstr = malloc(evlen)) == NULL)
-		goto oom;
-	    ep = evlog->env_add;
-	    if (strlcpy(evstr, *ep, evlen) >= evlen)
-		goto toobig;
-	    while (*++ep != NULL) {
-		if (strlcat(evstr, " ", evlen) >= evlen ||
-		    strlcat(evstr, *ep, evlen) >= evlen)
-		    goto toobig;
-	    }
-	    len += sizeof(LL_ENV_STR) + 2 + evlen;
-	}
-    }
-    if (evlog->command != NULL) {
-	len += sizeof(LL_CMND_STR) - 1 + strlen(evlog->command);
-	if (evlog->argv != NULL && evlog->argv[0] != NULL) {
-	    for (i = 1; evlog->argv[i] != NULL; i++)
-		len += strlen(evlog->argv[i]) + 1;
-	}
-	if (event_type == EVLOG_EXIT) {
-	    if (evlog->signal_name != NULL)
-		len += sizeof(LL_SIGNAL_STR) + 2 + strlen(evlog->signal_name);
-	    if (evlog->exit_value != -1) {
-		(void)snprintf(exit_str, sizeof(exit_str), "%d", evlog->exit_value);
-		len += sizeof(LL_EXIT_STR) + 2 + strlen(exit_str);
-	    }
+	    tty_len -= sizeof(_PATH_DEV) - 1;
 	}
     }
 
     /*
-     * Allocate and build up the line.
+     * Build up the line in a single pass over the fields.
+     * The buffer is grown on demand and reused across calls.
      */
-    if ((line = malloc(++len)) == NULL)
-	goto oom;
-    line[0] = '\0';
+    cur = logline_start();
 
     if (args->reason != NULL) {
-	if (strlcat(line, args->reason, len) >= len ||
-	    strlcat(line, args->errstr ? " : " : " ; ", len) >= len)
-	    goto toobig;
+	cur = append(cur, args->reason, strlen(args->reason));
+	cur = append(cur, args->errstr ? " : " : " ; ", 3);
     }
     if (args->errstr != NULL) {
-	if (strlcat(line, args->errstr, len) >= len ||
-	    strlcat(line, " ; ", len) >= len)
-	    goto toobig;
+	cur = append(cur, args->errstr, strlen(args->errstr));
+	cur = append(cur, " ; ", 3);
     }
     if (evlog->submithost != NULL && !evl_conf->omit_hostname) {
-	if (strlcat(line, LL_HOST_STR, len) >= len ||
-	    strlcat(line, evlog->submithost, len) >= len ||
-	    strlcat(line, " ; ", len) >= len)
-	    goto toobig;
+	cur = append(cur, LL_HOST_STR, LL_HOST_LEN);
+	cur = append(cur, evlog->submithost, strlen(evlog->submithost));
+	cur = append(cur, " ; ", 3);
     }
     if (tty != NULL) {
-	if (strlcat(line, LL_TTY_STR, len) >= len ||
-	    strlcat(line, tty, len) >= len ||
-	    strlcat(line, " ; ", len) >= len)
-	    goto toobig;
+	cur = append(cur, LL_TTY_STR, LL_TTY_LEN);
+	cur = append(cur, tty, tty_len);
+	cur = append(cur, " ; ", 3);
     }
     if (evlog->runchroot != NULL) {
-	if (strlcat(line, LL_CHROOT_STR, len) >= len ||
-	    strlcat(line, evlog->runchroot, len) >= len ||
-	    strlcat(line, " ; ", len) >= len)
-	    goto toobig;
+	cur = append(cur, LL_CHROOT_STR, LL_CHROOT_LEN);
+	cur = append(cur, evlog->runchroot, strlen(evlog->runchroot));
+	cur = append(cur, " ; ", 3);
     }
     if (evlog->runcwd != NULL) {
-	if (strlcat(line, LL_CWD_STR, len) >= len ||
-	    strlcat(line, evlog->runcwd, len) >= len ||
-	    strlcat(line, " ; ", len) >= len)
-	    goto toobig;
+	cur = append(cur, LL_CWD_STR, LL_CWD_LEN);
+	cur = append(cur, evlog->runcwd, strlen(evlog->runcwd));
+	cur = append(cur, " ; ", 3);
     }
     if (evlog->runuser != NULL) {
-	if (strlcat(line, LL_USER_STR, len) >= len ||
-	    strlcat(line, evlog->runuser, len) >= len ||
-	    strlcat(line, " ; ", len) >= len)
-	    goto toobig;
+	cur = append(cur, LL_USER_STR, LL_USER_LEN);
+	cur = append(cur, evlog->runuser, strlen(evlog->runuser));
+	cur = append(cur, " ; ", 3);
     }
     if (evlog->rungroup != NULL) {
-	if (strlcat(line, LL_GROUP_STR, len) >= len ||
-	    strlcat(line, evlog->rungroup, len) >= len ||
-	    strlcat(line, " ; ", len) >= len)
-	    goto toobig;
+	cur = append(cur, LL_GROUP_STR, LL_GROUP_LEN);
+	cur = append(cur, evlog->rungroup, strlen(evlog->rungroup));
+	cur = append(cur, " ; ", 3);
     }
     if (tsid != NULL) {
-	if (strlcat(line, LL_TSID_STR, len) >= len ||
-	    strlcat(line, tsid, len) >= len ||
-	    strlcat(line, offsetstr, len) >= len ||
-	    strlcat(line, " ; ", len) >= len)
-	    goto toobig;
-    }
-    if (evstr != NULL) {
-	if (strlcat(line, LL_ENV_STR, len) >= len ||
-	    strlcat(line, evstr, len) >= len ||
-	    strlcat(line, " ; ", len) >= len)
-	    goto toobig;
-	free(evstr);
-	evstr = NULL;
+	cur = append(cur, LL_TSID_STR, LL_TSID_LEN);
+	cur = append(cur, tsid, strlen(tsid));
+	cur = append(cur, offsetstr, offset_len);
+	cur = append(cur, " ; ", 3);
+    }
+    if (evlog->env_add != NULL && evlog->env_add[0] != NULL) {
+	char * const *ep = evlog->env_add;
+
+	cur = append(cur, LL_ENV_STR, LL_ENV_LEN);
+	cur = append(cur, *ep, strlen(*ep));
+	while (*++ep != NULL) {
+	    cur = append(cur, " ", 1);
+	    cur = append(cur, *ep, strlen(*ep));
+	}
+	cur = append(cur, " ; ", 3);
     }
     if (evlog->command != NULL) {
-	if (strlcat(line, LL_CMND_STR, len) >= len)
-	    goto toobig;
-	if (strlcat(line, evlog->command, len) >= len)
-	    goto toobig;
+	cur = append(cur, LL_CMND_STR, LL_CMND_LEN);
+	cur = append(cur, evlog->command, strlen(evlog->command));
 	if (evlog->argv != NULL && evlog->argv[0] != NULL) {
 	    for (i = 1; evlog->argv[i] != NULL; i++) {
-		if (strlcat(line, " ", len) >= len ||
-		    strlcat(line, evlog->argv[i], len) >= len)
-		    goto toobig;
+		cur = append(cur, " ", 1);
+		cur = append(cur, evlog->argv[i], strlen(evlog->argv[i]));
 	    }
 	}
 	if (event_type == EVLOG_EXIT) {
 	    if (evlog->signal_name != NULL) {
-		if (strlcat(line, " ; ", len) >= len ||
-		    strlcat(line, LL_SIGNAL_STR, len) >= len ||
-		    strlcat(line, evlog->signal_name, len) >= len)
-		    goto toobig;
+		cur = append(cur, " ; ", 3);
+		cur = append(cur, LL_SIGNAL_STR, LL_SIGNAL_LEN);
+		cur = append(cur, evlog->signal_name, strlen(evlog->signal_name));
 	    }
 	    if (evlog->exit_value != -1) {
-		if (strlcat(line, " ; ", len) >= len ||
-		    strlcat(line, LL_EXIT_STR, len) >= len ||
-		    strlcat(line, exit_str, len) >= len)
-		    goto toobig;
+		const size_t exit_len = format_int(exit_str,
+		    evlog->exit_value);
+		cur = append(cur, " ; ", 3);
+		cur = append(cur, LL_EXIT_STR, LL_EXIT_LEN);
+		cur = append(cur, exit_str, exit_len);
 	    }
 	}
     }
+    if (cur == NULL)
+	goto oom;
+    *cur = '\0';
+    logbuf_used = (size_t)(cur - logbuf);
 
-    debug_return_str(line);
+    debug_return_str(logbuf);
 oom:
-    free(evstr);
     sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
     debug_return_str(NULL);
-toobig:
-    free(evstr);
-    free(line);
-    sudo_warnx(U_("internal error, %s overflow"), __func__);
-    debug_return_str(NULL);
 }
 
+/*
+ * Close all fds >= lowfd other than the debug fds and keepfd.
+ * Pass -1 as keepfd to close all non-debug fds.
+ */
 static void
-closefrom_nodebug(int lowfd)
+closefrom_nodebug(int lowfd, int keepfd)
 {
     unsigned char *debug_fds;
     int fd, startfd;
+    const int debug_max = sudo_debug_get_fds(&debug_fds);
     debug_decl(closefrom_nodebug, SUDO_DEBUG_UTIL);
 
-    startfd = sudo_debug_get_fds(&debug_fds) + 1;
+    startfd = debug_max + 1;
     if (lowfd > startfd)
 	startfd = lowfd;
+    if (keepfd >= startfd)
+	startfd = keepfd + 1;
 
     /* Close fds higher than the debug fds. */
     sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
 	"closing fds >= %d", startfd);
     closefrom(startfd);
 
-    /* Close fds [lowfd, startfd) that are not in debug_fds. */
+    /* Close fds [lowfd, startfd) that are not in debug_fds (or keepfd). */
+#define eventlog_keep_fd(fd) \
+    ((fd) == keepfd || ((fd) <= debug_max && sudo_isset(debug_fds, fd)))
+#ifdef HAVE_CLOSE_RANGE
+    /* Batch contiguous runs of non-debug fds into one syscall each. */
+    fd = lowfd;
+    while (fd < startfd) {
+	int hifd;
+
+	while (fd < startfd && eventlog_keep_fd(fd))
+	    fd++;
+	if (fd >= startfd)
+	    break;
+	hifd = fd;
+	while (hifd + 1 < startfd && !eventlog_keep_fd(hifd + 1))
+	    hifd++;
+	sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
+	    "closing fds [%d, %d]", fd, hifd);
+	(void) close_range((unsigned int)fd, (unsigned int)hifd, 0);
+	fd = hifd + 1;
+    }
+#else
     for (fd = lowfd; fd < startfd; fd++) {
-	if (sudo_isset(debug_fds, fd))
+	if (eventlog_keep_fd(fd))
 	    continue;
 	sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
 	    "closing fd %d", fd);
-#ifdef __APPLE__
+# ifdef __APPLE__
 	/* Avoid potential libdispatch crash when we close its fds. */
 	(void) fcntl(fd, F_SETFD, FD_CLOEXEC);
-#else
+# else
 	(void) close(fd);
-#endif
+# endif
     }
+#endif /* HAVE_CLOSE_RANGE */
+#undef eventlog_keep_fd
     debug_return;
 }
 
@@ -353,8 +471,10 @@ static sudo_noreturn void
 exec_mailer(int pipein)
 {
     const struct eventlog_config *evl_conf = eventlog_getconf();
-    char *last, *mflags, *p, *argv[MAX_MAILFLAGS + 1];
+    char *mflags, *p, *argv[MAX_MAILFLAGS + 1];
+    char stackflags[1024];
     const char *mpath = evl_conf->mailerpath;
+    size_t n;
     int i;
     const char * const root_envp[] = {
 	"HOME=/",
@@ -377,8 +497,16 @@ exec_mailer(int pipein)
 	_exit(127);
     }
 
-    /* Build up an argv based on the mailer path and flags */
-    if ((mflags = strdup(evl_conf->mailerflags)) == NULL) {
+    /*
+     * Build up an argv based on the mailer path and flags.
+     * Tokenize a copy of the flags in place; we are about to exec so
+     * prefer the stack buffer and avoid heap allocation if possible.
+     */
+    n = strlen(evl_conf->mailerflags);
+    if (n < sizeof(stackflags)) {
+	memcpy(stackflags, evl_conf->mailerflags, n + 1);
+	mflags = stackflags;
+    } else if ((mflags = strdup(evl_conf->mailerflags)) == NULL) {
 	syslog(LOG_ERR, _("unable to allocate memory")); // -V618
 	sudo_debug_exit(__func__, __FILE__, __LINE__, sudo_debug_subsys);
 	_exit(127);
@@ -386,10 +514,17 @@ exec_mailer(int pipein)
     argv[0] = sudo_basename(mpath);
 
     i = 1;
-    if ((p = strtok_r(mflags, " \t", &last))) {
-	do {
-	    argv[i] = p;
-	} while (++i < MAX_MAILFLAGS && (p = strtok_r(NULL, " \t", &last)));
+    for (p = mflags; i < MAX_MAILFLAGS; ) {
+	while (*p == ' ' || *p == '\t')
+	    p++;
+	if (*p == '\0')
+	    break;
+	argv[i++] = p;
+	while (*p != '\0' && *p != ' ' && *p != '\t')
+	    p++;
+	if (*p == '\0')
+	    break;
+	*p++ = '\0';
     }
     argv[i] = NULL;
 
@@ -418,38 +553,147 @@ exec_mailer(int pipein)
     _exit(127);
 }
 
-/* Send a message to the mailto user */
+/*
+ * Socket to the long-lived mailer helper process, or -1 if the helper
+ * has not been started.  Each message is passed to the helper as a
+ * pipe fd sent over this socket; the helper runs the mailer with the
+ * pipe as stdin so message data never passes through the helper.
+ */
+static int mailer_sock = -1;
+
+/*
+ * Reap a child process, ignoring job control stops.
+ * SIGCHLD must be blocked by the caller.  Where sigwaitinfo() is
+ * available, wait for SIGCHLD and reap with WNOHANG instead of
+ * retrying waitpid() after every interrupting signal.
+ * Returns the child's pid (or -1 on error) with its status in status.
+ */
+static pid_t
+reap_child(pid_t pid, int *status)
+{
+    pid_t rv;
+#ifdef HAVE_SIGWAITINFO
+    sigset_t chldmask;
+
+    sigemptyset(&chldmask);
+    sigaddset(&chldmask, SIGCHLD);
+    for (;;) {
+	rv = waitpid(pid, status, WNOHANG);
+	if (rv == pid && !WIFSTOPPED(*status))
+	    break;
+	if (rv == -1 && errno != EINTR)
+	    break;
+	if (sigwaitinfo(&chldmask, NULL) == -1 && errno != EINTR)
+	    break;
+    }
+#else
+    for (;;) {
+	rv = waitpid(pid, status, 0);
+	if (rv == -1 && errno != EINTR)
+	    break;
+	if (rv != -1 && !WIFSTOPPED(*status))
+	    break;
+    }
+#endif /* HAVE_SIGWAITINFO */
+    return rv;
+}
+
+/*
+ * Main loop of the mailer helper.  Receives one pipe fd per message
+ * and runs the mailer with that pipe as stdin, reaping each mailer
+ * before the next message.  Exits when the socket is closed.
+ */
+static sudo_noreturn void
+run_mailer_helper(int sock)
+{
+    debug_decl(run_mailer_helper, SUDO_DEBUG_UTIL);
+
+    for (;;) {
+	union {
+	    struct cmsghdr hdr;
+	    char buf[CMSG_SPACE(sizeof(int))];
+	} cmsgbuf;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	sigset_t chldmask;
+	ssize_t nread;
+	char ch;
+	int fd = -1, status;
+	pid_t pid, rv;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &ch;
+	iov.iov_len = sizeof(ch);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	do {
+	    nread = recvmsg(sock, &msg, 0);
+	} while (nread == -1 && errno == EINTR);
+	if (nread <= 0) {
+	    /* Logging process closed the socket (or error), we are done. */
+	    break;
+	}
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+		cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+	    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+		memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+		break;
+	    }
+	}
+	if (fd == -1)
+	    continue;
+	(void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	switch (pid = sudo_debug_fork()) {
+	    case -1:
+		/* Error. */
+		syslog(LOG_ERR, _("unable to fork: %m")); // -V618
+		sudo_debug_printf(SUDO_DEBUG_ERROR, "unable to fork: %s",
+		    strerror(errno));
+		break;
+	    case 0:
+		/* Child.  Restore SIGCHLD for the mailer and exec it. */
+		sigemptyset(&chldmask);
+		sigaddset(&chldmask, SIGCHLD);
+		(void)sigprocmask(SIG_UNBLOCK, &chldmask, NULL);
+		exec_mailer(fd);
+		/* NOTREACHED */
+	    default:
+		rv = reap_child(pid, &status);
+		sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
+		    "mailer (%d) exit value %d", (int)rv, status);
+		break;
+	}
+	close(fd);
+    }
+    sudo_debug_exit(__func__, __FILE__, __LINE__, sudo_debug_subsys);
+    _exit(EXIT_SUCCESS);
+}
+
+/*
+ * Start the mailer helper process and connect it to mailer_sock.
+ * The helper is detached from our session via a double fork; only the
+ * intermediate child is waited for.  Returns true on success.
+ */
 static bool
-send_mail(const struct eventlog *evlog, const char *fmt, ...)
+start_mailer_helper(void)
 {
-    const struct eventlog_config *evl_conf = eventlog_getconf();
-    const char *cp, *timefmt = evl_conf->time_fmt;
     struct sigaction sa;
-    char timebuf[1024];
     sigset_t chldmask;
-    struct tm tm;
-    time_t now;
-    FILE *mail;
-    int fd, len, pfd[2], status;
+    int fd, sv[2], status;
     pid_t pid, rv;
-    struct stat sb;
-    va_list ap;
-#if defined(HAVE_NL_LANGINFO) && defined(CODESET)
-    char *locale;
-#endif
-    debug_decl(send_mail, SUDO_DEBUG_UTIL);
+    debug_decl(start_mailer_helper, SUDO_DEBUG_UTIL);
 
-    /* If mailer is disabled just return. */
-    if (evl_conf->mailerpath == NULL || evl_conf->mailto == NULL)
-	debug_return_bool(true);
-
-    /* Make sure the mailer exists and is a regular file. */
-    if (stat(evl_conf->mailerpath, &sb) != 0 || !S_ISREG(sb.st_mode))
-	debug_return_bool(false);
-
-    time(&now);
-    if (localtime_r(&now, &tm) == NULL)
+    if (socketpair(PF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+	sudo_warn("socketpair");
 	debug_return_bool(false);
+    }
+    (void) fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+    (void) fcntl(sv[1], F_SETFD, FD_CLOEXEC);
 
     /* Block SIGCHLD for the duration since we call waitpid() below. */
     sigemptyset(&chldmask);
@@ -461,12 +705,15 @@ send_mail(const struct eventlog *evlog, const char *fmt, ...)
 	case -1:
 	    /* Error. */
 	    sudo_warn("%s", U_("unable to fork"));
+	    close(sv[0]);
+	    close(sv[1]);
 
 	    /* Unblock SIGCHLD and return. */
 	    (void)sigprocmask(SIG_UNBLOCK, &chldmask, NULL);
 	    debug_return_bool(false);
 	case 0:
 	    /* Child. */
+	    close(sv[0]);
 	    switch (fork()) {
 		case -1:
 		    /* Error. */
@@ -486,28 +733,23 @@ send_mail(const struct eventlog *evlog, const char *fmt, ...)
 	    break;
 	default:
 	    /* Parent. */
-	    for (;;) {
-		rv = waitpid(pid, &status, 0);
-		if (rv == -1 && errno != EINTR)
-		    break;
-		if (rv != -1 && !WIFSTOPPED(status))
-		    break;
-	    }
+	    close(sv[1]);
+	    rv = reap_child(pid, &status);
 	    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
 		"child (%d) exit value %d", (int)rv, status);
 
 	    /* Unblock SIGCHLD and return. */
 	    (void)sigprocmask(SIG_UNBLOCK, &chldmask, NULL);
+	    mailer_sock = sv[0];
 	    debug_return_bool(true);
     }
 
-    /* Reset SIGCHLD to default and unblock it. */
+    /* Reset SIGCHLD to default; leave it blocked for reap_child(). */
     memset(&sa, 0, sizeof(sa));
     sigemptyset(&sa.sa_mask);
     sa.sa_flags = SA_RESTART;
     sa.sa_handler = SIG_DFL;
     (void)sigaction(SIGCHLD, &sa, NULL);
-    (void)sigprocmask(SIG_UNBLOCK, &chldmask, NULL);
 
     /* Daemonize - disassociate from session/tty. */
     if (setsid() == -1)
@@ -521,72 +763,264 @@ send_mail(const struct eventlog *evlog, const char *fmt, ...)
 	(void) dup2(fd, STDERR_FILENO);
     }
 
-    /* Close non-debug fds so we don't leak anything. */
-    closefrom_nodebug(STDERR_FILENO + 1);
+    /* Close non-debug fds other than the helper socket. */
+    closefrom_nodebug(STDERR_FILENO + 1, sv[1]);
 
-    if (pipe2(pfd, O_CLOEXEC) == -1) {
-	syslog(LOG_ERR, _("unable to open pipe: %m")); // -V618
-	sudo_debug_printf(SUDO_DEBUG_ERROR, "unable to open pipe: %s",
-	    strerror(errno));
-	sudo_debug_exit(__func__, __FILE__, __LINE__, sudo_debug_subsys);
-	_exit(EXIT_FAILURE);
-    }
+    run_mailer_helper(sv[1]);
+    /* NOTREACHED */
+}
 
-    switch (pid = sudo_debug_fork()) {
-	case -1:
-	    /* Error. */
-	    syslog(LOG_ERR, _("unable to fork: %m")); // -V618
-	    sudo_debug_printf(
-		SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
-		"unable to fork");
-	    sudo_debug_exit(__func__, __FILE__, __LINE__, sudo_debug_subsys);
-	    _exit(EXIT_FAILURE);
-	    break;
-	case 0:
-	    /* Child. */
-	    exec_mailer(pfd[0]);
-	    /* NOTREACHED */
+/*
+ * Pass the read end of a message pipe to the mailer helper, starting
+ * (or restarting) the helper as needed.
+ */
+static bool
+send_to_mailer_helper(int fd)
+{
+    union {
+	struct cmsghdr hdr;
+	char buf[CMSG_SPACE(sizeof(int))];
+    } cmsgbuf;
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    struct iovec iov;
+    bool restarted = false;
+    ssize_t nsent;
+    char ch = 0;
+    debug_decl(send_to_mailer_helper, SUDO_DEBUG_UTIL);
+
+restart:
+    if (mailer_sock == -1) {
+	if (!start_mailer_helper())
+	    debug_return_bool(false);
     }
 
-    (void) close(pfd[0]);
-    if ((mail = fdopen(pfd[1], "w")) == NULL) {
-	syslog(LOG_ERR, "fdopen: %m");
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = &ch;
+    iov.iov_len = sizeof(ch);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsgbuf.buf;
+    msg.msg_controllen = sizeof(cmsgbuf.buf);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    do {
+#ifdef MSG_NOSIGNAL
+	nsent = sendmsg(mailer_sock, &msg, MSG_NOSIGNAL);
+#else
+	nsent = sendmsg(mailer_sock, &msg, 0);
+#endif
+    } while (nsent == -1 && errno == EINTR);
+    if (nsent == -1) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
-	    "unable to fdopen pipe");
-	sudo_debug_exit(__func__, __FILE__, __LINE__, sudo_debug_subsys);
-	_exit(EXIT_FAILURE);
+	    "unable to send message to mailer helper");
+	close(mailer_sock);
+	mailer_sock = -1;
+	if (!restarted) {
+	    /* The helper may have died, restart it and retry once. */
+	    restarted = true;
+	    goto restart;
+	}
+	debug_return_bool(false);
     }
+    debug_return_bool(true);
+}
+
+/*
+ * Reusable buffer for composing mail messages, grown on demand.
+ */
+static char *mailbuf;
+static size_t mailbuf_size;
+
+/*
+ * Make sure mailbuf can hold at least len bytes, doubling as needed.
+ */
+static bool
+mailbuf_reserve(size_t len)
+{
+    size_t new_size = mailbuf_size ? mailbuf_size : 1024;
+    char *new_buf;
+
+    if (len <= mailbuf_size)
+	return true;
+    while (new_size < len)
+	new_size *= 2;
+    if ((new_buf = realloc(mailbuf, new_size)) == NULL)
+	return false;
+    mailbuf = new_buf;
+    mailbuf_size = new_size;
+    return true;
+}
+
+/*
+ * Append the first n bytes of s to mailbuf at offset *used.
+ * Returns true on success, false if memory allocation fails.
+ */
+static bool
+mail_puts(size_t *used, const char *s, size_t n)
+{
+    if (n + 1 > mailbuf_size - *used && !mailbuf_reserve(*used + n + 1))
+	return false;
+    memcpy(mailbuf + *used, s, n);
+    *used += n;
+    mailbuf[*used] = '\0';
+    return true;
+}
+
+/*
+ * Format fmt and arguments into mailbuf at offset *used.
+ * Returns true on success, false on formatting or allocation failure.
+ */
+static bool
+mail_vprintf(size_t *used, const char *fmt, va_list ap)
+{
+    va_list ap2;
+    int len;
+
+    va_copy(ap2, ap);
+    len = vsnprintf(mailbuf + *used, mailbuf_size - *used, fmt, ap2);
+    va_end(ap2);
+    if (len < 0)
+	return false;
+    if ((size_t)len >= mailbuf_size - *used) {
+	if (!mailbuf_reserve(*used + (size_t)len + 1))
+	    return false;
+	len = vsnprintf(mailbuf + *used, mailbuf_size - *used, fmt, ap);
+	if (len < 0)
+	    return false;
+    }
+    *used += (size_t)len;
+    return true;
+}
+
+static bool sudo_printflike(2, 3)
+mail_printf(size_t *used, const char *fmt, ...)
+{
+    va_list ap;
+    bool ret;
+
+    va_start(ap, fmt);
+    ret = mail_vprintf(used, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+/* Send a message to the mailto user */
+/*
+ * Cached result of the check that the mailer is a regular file,
+ * refreshed at most once a minute.  Avoids a stat() per message.
+ */
+static struct {
+    const char *path;
+    struct timespec checked;
+    bool ok;
+} mailer_check;
+
+static bool
+send_mail(const struct eventlog *evlog, const char *fmt, ...)
+{
+    const struct eventlog_config *evl_conf = eventlog_getconf();
+    const char *cp, *timefmt = evl_conf->time_fmt;
+    struct sigaction sa, saved_sa;
+    char timebuf[1024];
+    struct timespec ts;
+    struct tm tm;
+    time_t now;
+    size_t used = 0, nwritten;
+    bool ok = true;
+    int len, pfd[2];
+    struct stat sb;
+    va_list ap;
+#if defined(HAVE_NL_LANGINFO) && defined(CODESET)
+    char *locale;
+#endif
+    debug_decl(send_mail, SUDO_DEBUG_UTIL);
+
+    /* If mailer is disabled just return. */
+    if (evl_conf->mailerpath == NULL || evl_conf->mailto == NULL)
+	debug_return_bool(true);
+
+    /* Make sure the mailer exists and is a regular file. */
+    if (sudo_gettime_mono(&ts) == -1)
+	sudo_timespecclear(&ts);
+    if (mailer_check.path != evl_conf->mailerpath ||
+	    ts.tv_sec - mailer_check.checked.tv_sec >= 60) {
+	mailer_check.path = evl_conf->mailerpath;
+	mailer_check.checked = ts;
+	mailer_check.ok =
+	    stat(evl_conf->mailerpath, &sb) == 0 && S_ISREG(sb.st_mode);
+    }
+    if (!mailer_check.ok)
+	debug_return_bool(false);
 
-    /* Pipes are all setup, send message. */
-    (void) fprintf(mail, "To: %s\nFrom: %s\nAuto-Submitted: %s\nSubject: ",
+    time(&now);
+    if (localtime_r(&now, &tm) == NULL)
+	debug_return_bool(false);
+
+    /* Compose the entire message into mailbuf before touching the pipe. */
+    ok &= mail_printf(&used, "To: %s\nFrom: %s\nAuto-Submitted: %s\nSubject: ",
 	evl_conf->mailto,
 	evl_conf->mailfrom ? evl_conf->mailfrom :
 	(evlog ? evlog->submituser : "root"),
 	"auto-generated");
-    for (cp = _(evl_conf->mailsub); *cp; cp++) {
-	/* Expand escapes in the subject */
-	if (*cp == '%' && *(cp+1) != '%') {
-	    switch (*(++cp)) {
+
+    /* Expand escapes in the subject, copying the runs between them. */
+    cp = _(evl_conf->mailsub);
+    for (;;) {
+	const char *pct = strchr(cp, '%');
+
+	if (pct == NULL) {
+	    ok &= mail_puts(&used, cp, strlen(cp));
+	    break;
+	}
+	ok &= mail_puts(&used, cp, (size_t)(pct - cp));
+	cp = pct;
+	if (cp[1] == '%') {
+	    /* Emit one '%'; the second may itself start an escape. */
+	    ok &= mail_puts(&used, "%", 1);
+	    cp++;
+	} else {
+	    switch (cp[1]) {
 		case 'h':
 		    if (evlog != NULL)
-			(void) fputs(evlog->submithost, mail);
+			ok &= mail_puts(&used, evlog->submithost,
+			    strlen(evlog->submithost));
+		    cp += 2;
 		    break;
 		case 'u':
 		    if (evlog != NULL)
-			(void) fputs(evlog->submituser, mail);
+			ok &= mail_puts(&used, evlog->submituser,
+			    strlen(evlog->submituser));
+		    cp += 2;
 		    break;
 		default:
-		    cp--;
+		    /* Not an escape, swallow the '%' alone. */
+		    cp++;
 		    break;
 	    }
-	} else
-	    (void) fputc(*cp, mail);
+	}
     }
 
 #if defined(HAVE_NL_LANGINFO) && defined(CODESET)
-    locale = setlocale(LC_ALL, NULL);
-    if (locale[0] != 'C' || locale[1] != '\0')
-	(void) fprintf(mail, "\nContent-Type: text/plain; charset=\"%s\"\nContent-Transfer-Encoding: 8bit", nl_langinfo(CODESET));
+    /*
+     * The codeset is determined by LC_CTYPE, which is much cheaper to
+     * query than the composite LC_ALL locale.  Cache the codeset too,
+     * the locale rarely changes between calls.
+     */
+    locale = setlocale(LC_CTYPE, NULL);
+    if (locale[0] != 'C' || locale[1] != '\0') {
+	static char codeset[64], prev_locale[64];
+
+	if (strcmp(prev_locale, locale) != 0) {
+	    (void)strlcpy(prev_locale, locale, sizeof(prev_locale));
+	    (void)strlcpy(codeset, nl_langinfo(CODESET), sizeof(codeset));
+	}
+	ok &= mail_printf(&used, "\nContent-Type: text/plain; charset=\"%s\"\nContent-Transfer-Encoding: 8bit", codeset);
+    }
 #endif /* HAVE_NL_LANGINFO && CODESET */
 
     timebuf[sizeof(timebuf) - 1] = '\0';
@@ -602,28 +1036,57 @@ send_mail(const struct eventlog *evlog, const char *fmt, ...)
 	}
     }
     if (evlog != NULL) {
-	(void) fprintf(mail, "\n\n%s : %s : %s : ", evlog->submithost, timebuf,
-	    evlog->submituser);
+	ok &= mail_printf(&used, "\n\n%s : %s : %s : ", evlog->submithost,
+	    timebuf, evlog->submituser);
     } else {
-	(void) fprintf(mail, "\n\n%s : ", timebuf);
+	ok &= mail_printf(&used, "\n\n%s : ", timebuf);
     }
     va_start(ap, fmt);
-    (void) vfprintf(mail, fmt, ap);
+    ok &= mail_vprintf(&used, fmt, ap);
     va_end(ap);
-    fputs("\n\n", mail);
+    ok &= mail_puts(&used, "\n\n", 2);
+    if (!ok) {
+	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	debug_return_bool(false);
+    }
 
-    fclose(mail);
-    for (;;) {
-	rv = waitpid(pid, &status, 0);
-	if (rv == -1 && errno != EINTR)
-	    break;
-	if (rv != -1 && !WIFSTOPPED(status))
+    if (pipe2(pfd, O_CLOEXEC) == -1) {
+	sudo_warn("pipe2");
+	debug_return_bool(false);
+    }
+
+    /* Hand the read end to the mailer helper, which runs the mailer. */
+    if (!send_to_mailer_helper(pfd[0])) {
+	close(pfd[0]);
+	close(pfd[1]);
+	debug_return_bool(false);
+    }
+    close(pfd[0]);
+
+    /* Ignore SIGPIPE in case the mailer exits before reading the message. */
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sa.sa_handler = SIG_IGN;
+    (void)sigaction(SIGPIPE, &sa, &saved_sa);
+
+    /* Mail bodies are small, this is normally a single write. */
+    nwritten = 0;
+    while (nwritten < used) {
+	const ssize_t n = write(pfd[1], mailbuf + nwritten, used - nwritten);
+
+	if (n == -1) {
+	    if (errno == EINTR)
+		continue;
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
+		"unable to write mail message");
 	    break;
+	}
+	nwritten += (size_t)n;
     }
-    sudo_debug_printf(SUDO_DEBUG_INFO|SUDO_DEBUG_LINENO,
-	"child (%d) exit value %d", (int)rv, status);
-    sudo_debug_exit(__func__, __FILE__, __LINE__, sudo_debug_subsys);
-    _exit(EXIT_SUCCESS);
+    close(pfd[1]);
+    (void)sigaction(SIGPIPE, &saved_sa, NULL);
+    debug_return_bool(nwritten == used);
 }
 
 static bool
@@ -650,30 +1113,50 @@ json_add_timestamp(struct json_container *json, const char *name,
     if (format_timestamp) {
 	const struct eventlog_config *evl_conf = eventlog_getconf();
 	const char *timefmt = evl_conf->time_fmt;
+	static char iso_cache[64], local_cache[1024];
+	static const char *cached_fmt;
+	static time_t cached_sec;
+	static bool cached;
 	time_t secs = ts->tv_sec;
-	char timebuf[1024];
 	struct tm tm;
 
-	if (gmtime_r(&secs, &tm) != NULL) {
-	    timebuf[sizeof(timebuf) - 1] = '\0';
-	    len = strftime(timebuf, sizeof(timebuf), "%Y%m%d%H%M%SZ", &tm);
-	    if (len != 0 && timebuf[sizeof(timebuf) - 1] == '\0') {
-		json_value.type = JSON_STRING;
-		json_value.u.string = timebuf; // -V507
-		if (!sudo_json_add_value(json, "iso8601", &json_value))
-		    goto oom;
+	/*
+	 * Events often arrive in bursts within the same second; cache
+	 * the formatted strings so repeated timestamps skip the
+	 * gmtime/localtime/strftime calls entirely.
+	 */
+	if (!cached || secs != cached_sec || timefmt != cached_fmt) {
+	    iso_cache[0] = local_cache[0] = '\0';
+	    if (gmtime_r(&secs, &tm) != NULL) {
+		iso_cache[sizeof(iso_cache) - 1] = '\0';
+		len = strftime(iso_cache, sizeof(iso_cache), "%Y%m%d%H%M%SZ",
+		    &tm);
+		if (len == 0 || iso_cache[sizeof(iso_cache) - 1] != '\0')
+		    iso_cache[0] = '\0';
 	    }
+	    if (localtime_r(&secs, &tm) != NULL) {
+		local_cache[sizeof(local_cache) - 1] = '\0';
+		len = strftime(local_cache, sizeof(local_cache), timefmt, &tm);
+		if (len == 0 || local_cache[sizeof(local_cache) - 1] != '\0')
+		    local_cache[0] = '\0';
+	    }
+	    cached_sec = secs;
+	    cached_fmt = timefmt;
+	    cached = true;
 	}
 
-	if (localtime_r(&secs, &tm) != NULL) {
-	    timebuf[sizeof(timebuf) - 1] = '\0';
-	    len = strftime(timebuf, sizeof(timebuf), timefmt, &tm);
-	    if (len != 0 && timebuf[sizeof(timebuf) - 1] == '\0') {
-		json_value.type = JSON_STRING;
-		json_value.u.string = timebuf; // -V507
-		if (!sudo_json_add_value(json, "localtime", &json_value))
-		    goto oom;
-	    }
+	if (iso_cache[0] != '\0') {
+	    json_value.type = JSON_STRING;
+	    json_value.u.string = iso_cache;
+	    if (!sudo_json_add_value(json, "iso8601", &json_value))
+		goto oom;
+	}
+
+	if (local_cache[0] != '\0') {
+	    json_value.type = JSON_STRING;
+	    json_value.u.string = local_cache;
+	    if (!sudo_json_add_value(json, "localtime", &json_value))
+		goto oom;
 	}
     }
 
@@ -687,6 +1170,24 @@ oom:
     debug_return_bool(false);
 }
 
+/*
+ * Optional eventlog string fields stored by eventlog_store_json(),
+ * in the order they are written.
+ */
+static const struct evlog_json_str_field {
+    const char *name;
+    size_t off;
+} evlog_json_str_fields[] = {
+    { "command", offsetof(struct eventlog, command) },
+    { "runuser", offsetof(struct eventlog, runuser) },
+    { "rungroup", offsetof(struct eventlog, rungroup) },
+    { "runchroot", offsetof(struct eventlog, runchroot) },
+    { "runcwd", offsetof(struct eventlog, runcwd) },
+    { "ttyname", offsetof(struct eventlog, ttyname) },
+    { "submithost", offsetof(struct eventlog, submithost) },
+    { "submitcwd", offsetof(struct eventlog, cwd) }
+};
+
 /*
  * Store the contents of struct eventlog as JSON.
  * The submit_time and iolog_path members are not stored, they should
@@ -715,60 +1216,17 @@ eventlog_store_json(struct json_container *json, const struct eventlog *evlog)
     if (!sudo_json_add_value(json, "submituser", &json_value))
 	goto oom;
 
-    if (evlog->command != NULL) {
-	json_value.type = JSON_STRING;
-	json_value.u.string = evlog->command;
-	if (!sudo_json_add_value(json, "command", &json_value))
-	    goto oom;
-    }
-
-    if (evlog->runuser != NULL) {
-	json_value.type = JSON_STRING;
-	json_value.u.string = evlog->runuser;
-	if (!sudo_json_add_value(json, "runuser", &json_value))
-	    goto oom;
-    }
-
-    if (evlog->rungroup != NULL) {
-	json_value.type = JSON_STRING;
-	json_value.u.string = evlog->rungroup;
-	if (!sudo_json_add_value(json, "rungroup", &json_value))
-	    goto oom;
-    }
-
-    if (evlog->runchroot != NULL) {
-	json_value.type = JSON_STRING;
-	json_value.u.string = evlog->runchroot;
-	if (!sudo_json_add_value(json, "runchroot", &json_value))
-	    goto oom;
-    }
-
-    if (evlog->runcwd != NULL) {
-	json_value.type = JSON_STRING;
-	json_value.u.string = evlog->runcwd;
-	if (!sudo_json_add_value(json, "runcwd", &json_value))
-	    goto oom;
-    }
+    for (i = 0; i < nitems(evlog_json_str_fields); i++) {
+	const struct evlog_json_str_field *f = &evlog_json_str_fields[i];
+	const char *str =
+	    *(const char * const *)((const char *)evlog + f->off);
 
-    if (evlog->ttyname != NULL) {
-	json_value.type = JSON_STRING;
-	json_value.u.string = evlog->ttyname;
-	if (!sudo_json_add_value(json, "ttyname", &json_value))
-	    goto oom;
-    }
-
-    if (evlog->submithost != NULL) {
-	json_value.type = JSON_STRING;
-	json_value.u.string = evlog->submithost;
-	if (!sudo_json_add_value(json, "submithost", &json_value))
-	    goto oom;
-    }
-
-    if (evlog->cwd != NULL) {
-	json_value.type = JSON_STRING;
-	json_value.u.string = evlog->cwd;
-	if (!sudo_json_add_value(json, "submitcwd", &json_value))
-	    goto oom;
+	if (str != NULL) {
+	    json_value.type = JSON_STRING;
+	    json_value.u.string = str;
+	    if (!sudo_json_add_value(json, f->name, &json_value))
+		goto oom;
+	}
     }
 
     if (evlog->rungroup!= NULL && evlog->rungid != (gid_t)-1) {
@@ -834,13 +1292,51 @@ default_json_cb(struct json_container *json, void *v)
     return eventlog_store_json(json, v);
 }
 
-static char *
+/*
+ * Estimate the formatted size of the JSON version of evlog so the
+ * json buffer can be sized with a single allocation.  The estimate
+ * is deliberately generous; the buffer still grows if it proves too
+ * small.
+ */
+static size_t
+json_size_hint(struct eventlog_args *args, const struct eventlog *evlog)
+{
+    size_t len = 1024;
+    debug_decl(json_size_hint, SUDO_DEBUG_UTIL);
+
+    if (args->reason != NULL)
+	len += strlen(args->reason) + 32;
+    if (args->errstr != NULL)
+	len += strlen(args->errstr) + 32;
+    if (evlog != NULL) {
+	char * const *ep;
+
+#define field_hint(f) (evlog->f != NULL ? strlen(evlog->f) + 32 : 0)
+	len += field_hint(submituser) + field_hint(command) +
+	    field_hint(runuser) + field_hint(rungroup) +
+	    field_hint(runchroot) + field_hint(runcwd) +
+	    field_hint(ttyname) + field_hint(submithost) +
+	    field_hint(cwd) + field_hint(iolog_path) +
+	    field_hint(peeraddr) + field_hint(signal_name);
+#undef field_hint
+	if (evlog->argv != NULL) {
+	    for (ep = evlog->argv; *ep != NULL; ep++)
+		len += strlen(*ep) + 24;
+	}
+	if (evlog->envp != NULL) {
+	    for (ep = evlog->envp; *ep != NULL; ep++)
+		len += strlen(*ep) + 24;
+	}
+    }
+    debug_return_size_t(len);
+}
+
+static bool
 format_json(int event_type, struct eventlog_args *args,
-    const struct eventlog *evlog, bool compact)
+    const struct eventlog *evlog, bool compact, struct json_container *json)
 {
     eventlog_json_callback_t info_cb = args->json_info_cb;
     void *info = args->json_info;
-    struct json_container json = { 0 };
     struct json_value json_value;
     const char *time_str, *type_str;
     struct timespec now;
@@ -854,7 +1350,7 @@ format_json(int event_type, struct eventlog_args *args,
     if (sudo_gettime_real(&now) == -1) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
 	    "unable to read the clock");
-	debug_return_str(NULL);
+	debug_return_bool(false);
     }
 
     switch (event_type) {
@@ -877,18 +1373,19 @@ format_json(int event_type, struct eventlog_args *args,
     default:
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 	    "unexpected event type %d", event_type);
-	debug_return_str(NULL);
+	debug_return_bool(false);
     }
 
-    if (!sudo_json_init(&json, 4, compact, false))
+    if (!sudo_json_initsz(json, 4, compact, false,
+	    (unsigned int)json_size_hint(args, evlog)))
 	goto bad;
-    if (!sudo_json_open_object(&json, type_str))
+    if (!sudo_json_open_object(json, type_str))
 	goto bad;
 
     if (evlog != NULL && evlog->uuid_str[0] != '\0') {
 	json_value.type = JSON_STRING;
 	json_value.u.string = evlog->uuid_str;
-	if (!sudo_json_add_value(&json, "uuid", &json_value))
+	if (!sudo_json_add_value(json, "uuid", &json_value))
 	    goto bad;
     }
 
@@ -907,7 +1404,7 @@ format_json(int event_type, struct eventlog_args *args,
 	}
 	json_value.type = JSON_STRING;
 	json_value.u.string = ereason ? ereason : args->reason;
-	if (!sudo_json_add_value(&json, "reason", &json_value)) {
+	if (!sudo_json_add_value(json, "reason", &json_value)) {
 	    free(ereason);
 	    goto bad;
 	}
@@ -915,7 +1412,7 @@ format_json(int event_type, struct eventlog_args *args,
     }
 
     /* Log event time on server (set earlier) */
-    if (!json_add_timestamp(&json, "server_time", &now, true)) {
+    if (!json_add_timestamp(json, "server_time", &now, true)) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 	    "unable format timestamp");
 	goto bad;
@@ -923,7 +1420,7 @@ format_json(int event_type, struct eventlog_args *args,
 
     /* Log event time from client */
     if (args->event_time != NULL) {
-	if (!json_add_timestamp(&json, time_str, args->event_time, true)) {
+	if (!json_add_timestamp(json, time_str, args->event_time, true)) {
 	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 		"unable format timestamp");
 	    goto bad;
@@ -938,7 +1435,7 @@ format_json(int event_type, struct eventlog_args *args,
 	}
 
 	if (sudo_timespecisset(&evlog->run_time)) {
-	    if (!json_add_timestamp(&json, "run_time", &evlog->run_time, false)) {
+	    if (!json_add_timestamp(json, "run_time", &evlog->run_time, false)) {
 		sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 		    "unable format timestamp");
 		goto bad;
@@ -947,17 +1444,17 @@ format_json(int event_type, struct eventlog_args *args,
 	if (evlog->signal_name != NULL) {
 	    json_value.type = JSON_STRING;
 	    json_value.u.string = evlog->signal_name;
-	    if (!sudo_json_add_value(&json, "signal", &json_value))
+	    if (!sudo_json_add_value(json, "signal", &json_value))
 		goto bad;
 
 	    json_value.type = JSON_BOOL;
 	    json_value.u.boolean = evlog->dumped_core;
-	    if (!sudo_json_add_value(&json, "dumped_core", &json_value))
+	    if (!sudo_json_add_value(json, "dumped_core", &json_value))
 		goto bad;
 	}
 	json_value.type = JSON_NUMBER;
 	json_value.u.number = evlog->exit_value;
-	if (!sudo_json_add_value(&json, "exit_value", &json_value))
+	if (!sudo_json_add_value(json, "exit_value", &json_value))
 	    goto bad;
     }
 
@@ -966,18 +1463,18 @@ format_json(int event_type, struct eventlog_args *args,
 	if (evlog->peeraddr != NULL) {
 	    json_value.type = JSON_STRING;
 	    json_value.u.string = evlog->peeraddr;
-	    if (!sudo_json_add_value(&json, "peeraddr", &json_value))
+	    if (!sudo_json_add_value(json, "peeraddr", &json_value))
 		goto bad;
 	}
 
 	if (evlog->iolog_path != NULL) {
 	    json_value.type = JSON_STRING;
 	    json_value.u.string = evlog->iolog_path;
-	    if (!sudo_json_add_value(&json, "iolog_path", &json_value))
+	    if (!sudo_json_add_value(json, "iolog_path", &json_value))
 		goto bad;
 
 	    if (sudo_timespecisset(&evlog->iolog_offset)) {
-		if (!json_add_timestamp(&json, "iolog_offset", &evlog->iolog_offset, false)) {
+		if (!json_add_timestamp(json, "iolog_offset", &evlog->iolog_offset, false)) {
 		    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 			"unable format timestamp");
 		    goto bad;
@@ -988,19 +1485,38 @@ format_json(int event_type, struct eventlog_args *args,
 
     /* Write log info. */
     if (info != NULL) {
-	if (!info_cb(&json, info))
+	if (!info_cb(json, info))
 	    goto bad;
     }
 
-    if (!sudo_json_close_object(&json))
+    if (!sudo_json_close_object(json))
 	goto bad;
 
-    /* Caller is responsible for freeing the buffer. */
-    debug_return_str(sudo_json_get_buf(&json));
+    /* Caller must release the container with sudo_json_free(). */
+    debug_return_bool(true);
 
 bad:
-    sudo_json_free(&json);
-    debug_return_str(NULL);
+    sudo_json_free(json);
+    debug_return_bool(false);
+}
+
+/*
+ * Mail the event as a JSON record, formatting it if needed.
+ * The formatted record is kept in args for reuse by the other sinks.
+ */
+static bool
+send_mail_json(int event_type, struct eventlog_args *args,
+    const struct eventlog *evlog)
+{
+    debug_decl(send_mail_json, SUDO_DEBUG_UTIL);
+
+    if (!args->shared_json_valid) {
+	if (!format_json(event_type, args, evlog, true, &args->shared_json))
+	    debug_return_bool(false);
+	args->shared_json_valid = true;
+    }
+    debug_return_bool(send_mail(evlog, "{%s}",
+	sudo_json_get_buf(&args->shared_json)));
 }
 
 /*
@@ -1008,30 +1524,37 @@ bad:
  * message into parts if it is longer than syslog_maxlen.
  */
 static bool
-do_syslog_sudo(int pri, char *logline, const struct eventlog *evlog)
+do_syslog_sudo(const struct eventlog_config *evl_conf, int pri,
+    char *logline, const struct eventlog *evlog)
 {
-    const struct eventlog_config *evl_conf = eventlog_getconf();
-    size_t len, maxlen;
+    size_t cont_maxlen, len, maxlen, user_len;
     char *p, *tmp, save;
-    const char *fmt;
+    const char *cont_fmt, *fmt;
     debug_decl(do_syslog_sudo, SUDO_DEBUG_UTIL);
 
-    evl_conf->open_log(EVLOG_SYSLOG, NULL);
-
     if (evlog == NULL) {
 	/* Not a command, just log it as-is. */
 	syslog(pri, "%s", logline);
-	goto done;
+	debug_return_bool(true);
     }
 
     /*
      * Log the full line, breaking into multiple syslog(3) calls if necessary
+     * The length of the submituser and format strings is constant, hoist
+     * the gettext() calls out of the loop and let the compiler fold the
+     * format lengths; syslog_maxlen is a conservative budget so a
+     * translation of slightly different length is not a problem.
      */
+    user_len = strlen(evlog->submituser);
+    cont_fmt = _("%8s : (command continued) %s");
+    cont_maxlen = evl_conf->syslog_maxlen -
+	(sizeof("%8s : (command continued) %s") - 1 - 5 + user_len);
     fmt = _("%8s : %s");
     maxlen = evl_conf->syslog_maxlen -
-	(strlen(fmt) - 5 + strlen(evlog->submituser));
+	(sizeof("%8s : %s") - 1 - 5 + user_len);
     for (p = logline; *p != '\0'; ) {
-	len = strlen(p);
+	/* new_logline() tracked the line length for us. */
+	len = logbuf_used - (size_t)(p - logline);
 	if (len > maxlen) {
 	    /*
 	     * Break up the line into what will fit on one syslog(3) line
@@ -1056,126 +1579,140 @@ do_syslog_sudo(int pri, char *logline, const struct eventlog *evlog)
 	    syslog(pri, fmt, evlog->submituser, p);
 	    p += len;
 	}
-	fmt = _("%8s : (command continued) %s");
-	maxlen = evl_conf->syslog_maxlen -
-	    (strlen(fmt) - 5 + strlen(evlog->submituser));
+	fmt = cont_fmt;
+	maxlen = cont_maxlen;
     }
-done:
-    evl_conf->close_log(EVLOG_SYSLOG, NULL);
 
     debug_return_bool(true);
 }
 
 static bool
-do_syslog_json(int pri, int event_type, struct eventlog_args *args,
-    const struct eventlog *evlog)
+do_syslog_json(const struct eventlog_config *evl_conf, int pri,
+    int event_type, struct eventlog_args *args, const struct eventlog *evlog)
 {
-    const struct eventlog_config *evl_conf = eventlog_getconf();
-    char *json_str;
+    struct json_container json;
     debug_decl(do_syslog_json, SUDO_DEBUG_UTIL);
 
-    /* Format as a compact JSON message (no newlines) */
-    json_str = format_json(event_type, args, evlog, true);
-    if (json_str == NULL)
-	debug_return_bool(false);
+    if (args->shared_json_valid) {
+	/* Reuse the record that was formatted for the mail sink. */
+	json = args->shared_json;
+	args->shared_json_valid = false;
+    } else {
+	/* Format as a compact JSON message (no newlines) */
+	if (!format_json(event_type, args, evlog, true, &json))
+	    debug_return_bool(false);
+    }
 
     /* Syslog it in a sudo object with a @cee: prefix. */
     /* TODO: use evl_conf->syslog_maxlen to break up long messages. */
-    evl_conf->open_log(EVLOG_SYSLOG, NULL);
-    syslog(pri, "@cee:{\"sudo\":{%s}}", json_str);
-    evl_conf->close_log(EVLOG_SYSLOG, NULL);
-    free(json_str);
+    syslog(pri, "@cee:{\"sudo\":{%s}}", sudo_json_get_buf(&json));
+
+    /*
+     * If the file sink will also log this event as JSON, pass the
+     * formatted record along so it is not formatted a second time.
+     */
+    if (ISSET(evl_conf->type, EVLOG_FILE)) {
+	args->shared_json = json;
+	args->shared_json_valid = true;
+    } else {
+	sudo_json_free(&json);
+    }
     debug_return_bool(true);
 }
 
+/*
+ * Syslog priority for each event type, stored as an offset into
+ * struct eventlog_config so the configured value is picked up.
+ */
+static const size_t evlog_pri_offsets[] = {
+    offsetof(struct eventlog_config, syslog_acceptpri),	/* EVLOG_ACCEPT */
+    offsetof(struct eventlog_config, syslog_rejectpri),	/* EVLOG_REJECT */
+    offsetof(struct eventlog_config, syslog_acceptpri),	/* EVLOG_EXIT */
+    offsetof(struct eventlog_config, syslog_alertpri)	/* EVLOG_ALERT */
+};
+
 /*
  * Log a message to syslog in either sudo or JSON format.
  */
 static bool
-do_syslog(int event_type, int flags, struct eventlog_args *args,
-    const struct eventlog *evlog)
+do_syslog(const struct eventlog_config *evl_conf, int event_type, int flags,
+    struct eventlog_args *args, const struct eventlog *evlog)
 {
-    const struct eventlog_config *evl_conf = eventlog_getconf();
-    char *logline = NULL;
+    const char *logline = NULL;
     bool ret = false;
     int pri;
     debug_decl(do_syslog, SUDO_DEBUG_UTIL);
 
-    /* Sudo format logs and mailed logs use the same log line format. */
-    if (evl_conf->format == EVLOG_SUDO || ISSET(flags, EVLOG_MAIL)) {
-	logline = new_logline(event_type, flags, args, evlog);
+    /*
+     * Sudo format logs and mailed logs use the same log line format.
+     * The line is built at most once per event and shared via args.
+     * In JSON mode the mail body is the shared JSON record instead,
+     * which avoids building a log line no other sink will use.
+     */
+    if (evl_conf->format == EVLOG_SUDO) {
+	if (args->logline == NULL)
+	    args->logline = new_logline(event_type, flags, args, evlog);
+	logline = args->logline;
 	if (logline == NULL)
 	    debug_return_bool(false);
-
-	if (ISSET(flags, EVLOG_MAIL)) {
-	    if (!send_mail(evlog, "%s", logline)) {
-		sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
-		    "unable to mail log line");
-	    }
-	    if (ISSET(flags, EVLOG_MAIL_ONLY)) {
-		free(logline);
-		debug_return_bool(true);
-	    }
+    }
+    if (ISSET(flags, EVLOG_MAIL)) {
+	if (logline != NULL ? !send_mail(evlog, "%s", logline) :
+		!send_mail_json(event_type, args, evlog)) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+		"unable to mail log line");
 	}
+	if (ISSET(flags, EVLOG_MAIL_ONLY))
+	    debug_return_bool(true);
     }
 
-    switch (event_type) {
-    case EVLOG_ACCEPT:
-    case EVLOG_EXIT:
-	pri = evl_conf->syslog_acceptpri;
-	break;
-    case EVLOG_REJECT:
-	pri = evl_conf->syslog_rejectpri;
-	break;
-    case EVLOG_ALERT:
-	pri = evl_conf->syslog_alertpri;
-	break;
-    default:
+    /* Map the event type to the configured syslog priority. */
+    if ((unsigned int)event_type < nitems(evlog_pri_offsets)) {
+	pri = *(const int *)((const char *)evl_conf +
+	    evlog_pri_offsets[event_type]);
+    } else {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 	    "unexpected event type %d", event_type);
 	pri = -1;
-	break;
     }
     if (pri == -1) {
 	/* syslog disabled for this message type */
-	free(logline);
 	debug_return_bool(true);
     }
 
+    /* Open the syslog connection once, regardless of format. */
+    evl_conf->open_log(EVLOG_SYSLOG, NULL);
+
     switch (evl_conf->format) {
     case EVLOG_SUDO:
-	ret = do_syslog_sudo(pri, logline, evlog);
+	/* Note: do_syslog_sudo() temporarily modifies the line in place. */
+	ret = do_syslog_sudo(evl_conf, pri, (char *)logline, evlog);
 	break;
     case EVLOG_JSON:
-	ret = do_syslog_json(pri, event_type, args, evlog);
+	ret = do_syslog_json(evl_conf, pri, event_type, args, evlog);
 	break;
     default:
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 	    "unexpected eventlog format %d", evl_conf->format);
 	break;
     }
-    free(logline);
+    evl_conf->close_log(EVLOG_SYSLOG, NULL);
 
     debug_return_bool(ret);
 }
 
 static bool
-do_logfile_sudo(const char *logline, const struct eventlog *evlog,
+do_logfile_sudo(const struct eventlog_config *evl_conf, FILE *fp,
+    const char *logline, const struct eventlog *evlog,
     const struct timespec *event_time)
 {
-    const struct eventlog_config *evl_conf = eventlog_getconf();
-    char *full_line, timebuf[8192], *timestr = NULL;
+    char linebuf[8192], *full_line = linebuf, *timestr = NULL;
     const char *timefmt = evl_conf->time_fmt;
     const char *logfile = evl_conf->logpath;
-    struct tm tm;
     bool ret = false;
-    FILE *fp;
     int len;
     debug_decl(do_logfile_sudo, SUDO_DEBUG_UTIL);
 
-    if ((fp = evl_conf->open_log(EVLOG_FILE, logfile)) == NULL)
-	debug_return_bool(false);
-
     if (!sudo_lock_file(fileno(fp), SUDO_LOCK)) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
 	    "unable to lock log file %s", logfile);
@@ -1183,29 +1720,58 @@ do_logfile_sudo(const char *logline, const struct eventlog *evlog,
     }
 
     if (event_time != NULL) {
-	time_t tv_sec = event_time->tv_sec;
-	if (localtime_r(&tv_sec, &tm) != NULL) {
-	    /* strftime() does not guarantee to NUL-terminate so we must check. */
-	    timebuf[sizeof(timebuf) - 1] = '\0';
-	    if (strftime(timebuf, sizeof(timebuf), timefmt, &tm) != 0 &&
-		    timebuf[sizeof(timebuf) - 1] == '\0') {
-		timestr = timebuf;
+	/*
+	 * The formatted time stamp only changes once a second; cache it
+	 * so back-to-back log lines skip localtime_r() and strftime().
+	 */
+	static char timebuf[8192];
+	static const char *cached_fmt;
+	static time_t cached_sec;
+	static bool cached_valid;
+
+	if (event_time->tv_sec != cached_sec || timefmt != cached_fmt) {
+	    time_t tv_sec = event_time->tv_sec;
+	    struct tm tm;
+
+	    cached_sec = event_time->tv_sec;
+	    cached_fmt = timefmt;
+	    cached_valid = false;
+	    if (localtime_r(&tv_sec, &tm) != NULL) {
+		/* strftime() does not guarantee to NUL-terminate so we must check. */
+		timebuf[sizeof(timebuf) - 1] = '\0';
+		if (strftime(timebuf, sizeof(timebuf), timefmt, &tm) != 0 &&
+			timebuf[sizeof(timebuf) - 1] == '\0')
+		    cached_valid = true;
 	    }
 	}
+	if (cached_valid)
+	    timestr = timebuf;
     }
+    /* Most lines fit in the stack buffer, only fall back to the heap
+     * for very long ones. */
     if (evlog != NULL) {
-	len = asprintf(&full_line, "%s : %s : %s",
+	len = snprintf(linebuf, sizeof(linebuf), "%s : %s : %s",
 	    timestr ? timestr : "invalid date", evlog->submituser, logline);
+	if (len >= ssizeof(linebuf)) {
+	    len = asprintf(&full_line, "%s : %s : %s",
+		timestr ? timestr : "invalid date", evlog->submituser,
+		logline);
+	}
     } else {
-	len = asprintf(&full_line, "%s : %s",
+	len = snprintf(linebuf, sizeof(linebuf), "%s : %s",
 	    timestr ? timestr : "invalid date", logline);
+	if (len >= ssizeof(linebuf)) {
+	    len = asprintf(&full_line, "%s : %s",
+		timestr ? timestr : "invalid date", logline);
+	}
     }
     if (len == -1) {
 	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
 	goto done;
     }
     eventlog_writeln(fp, full_line, len, evl_conf->file_maxlen);
-    free(full_line);
+    if (full_line != linebuf)
+	free(full_line);
     (void)fflush(fp);
     if (ferror(fp)) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
@@ -1216,107 +1782,117 @@ do_logfile_sudo(const char *logline, const struct eventlog *evlog,
 
 done:
     (void)sudo_lock_file(fileno(fp), SUDO_UNLOCK);
-    evl_conf->close_log(EVLOG_FILE, fp);
     debug_return_bool(ret);
 }
 
 static bool
-do_logfile_json(int event_type, struct eventlog_args *args,
-    const struct eventlog *evlog)
+do_logfile_json(const struct eventlog_config *evl_conf, FILE *fp,
+    int event_type, struct eventlog_args *args, const struct eventlog *evlog)
 {
-    const struct eventlog_config *evl_conf = eventlog_getconf();
     const char *logfile = evl_conf->logpath;
-    struct stat sb;
-    char *json_str;
-    int ret = false;
-    FILE *fp;
+    struct json_container json = { 0 };
+    struct iovec iov[3];
+    int fd, ret = false;
+    off_t pos;
     debug_decl(do_logfile_json, SUDO_DEBUG_UTIL);
 
-    if ((fp = evl_conf->open_log(EVLOG_FILE, logfile)) == NULL)
-	debug_return_bool(false);
-
-    json_str = format_json(event_type, args, evlog, false);
-    if (json_str == NULL)
+    if (args->shared_json_valid) {
+	/* Reuse the (compact) record formatted for syslog or mail. */
+	json = args->shared_json;
+	args->shared_json_valid = false;
+    } else if (!format_json(event_type, args, evlog, false, &json)) {
 	goto done;
+    }
 
-    if (!sudo_lock_file(fileno(fp), SUDO_LOCK)) {
+    fd = fileno(fp);
+    if (!sudo_lock_file(fd, SUDO_LOCK)) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO|SUDO_DEBUG_ERRNO,
 	    "unable to lock log file %s", logfile);
 	goto done;
     }
 
-    /* Note: assumes file ends in "\n}\n" */
-    if (fstat(fileno(fp), &sb) == -1) {
+    /*
+     * Write the record and the closing "\n}\n" with a single writev(2)
+     * directly to the fd, bypassing stdio.  Note: assumes a non-empty
+     * file ends in "\n}\n", which we back up over and rewrite.
+     */
+    pos = lseek(fd, 0, SEEK_END);
+    if (pos == -1 || (pos != 0 && lseek(fd, -3, SEEK_END) == -1)) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
-	    "unable to stat %s", logfile);
+	    "unable to seek %s", logfile);
 	goto done;
     }
-    if (sb.st_size == 0) {
-	/* New file */
-	putc('{', fp);
-    } else if (fseeko(fp, -3, SEEK_END) == 0) {
-	/* Continue file, overwrite the final "\n}\n" */
-	putc(',', fp);
-    } else {
+    iov[0].iov_base = (char *)(pos == 0 ? "{" : ",");
+    iov[0].iov_len = 1;
+    iov[1].iov_base = sudo_json_get_buf(&json);
+    iov[1].iov_len = sudo_json_get_len(&json);
+    iov[2].iov_base = (char *)"\n}\n";			/* close JSON */
+    iov[2].iov_len = 3;
+    if (writev(fd, iov, 3) == -1) {
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_ERRNO|SUDO_DEBUG_LINENO,
-	    "unable to seek %s", logfile);
+	    "unable to write %s", logfile);
+	/* Back up and try to restore the original state. */
+	if (pos != 0 && lseek(fd, pos - 3, SEEK_SET) != -1)
+	    ignore_result(write(fd, "\n}\n", 3));
 	goto done;
     }
-    fputs(json_str, fp);
-    fputs("\n}\n", fp);			/* close JSON */
-    fflush(fp);
-    /* XXX - check for file error and recover */
 
     ret = true;
 
 done:
-    free(json_str);
+    sudo_json_free(&json);
     (void)sudo_lock_file(fileno(fp), SUDO_UNLOCK);
-    evl_conf->close_log(EVLOG_FILE, fp);
     debug_return_bool(ret);
 }
 
 static bool
-do_logfile(int event_type, int flags, struct eventlog_args *args,
-    const struct eventlog *evlog)
+do_logfile(const struct eventlog_config *evl_conf, int event_type, int flags,
+    struct eventlog_args *args, const struct eventlog *evlog)
 {
-    const struct eventlog_config *evl_conf = eventlog_getconf();
     bool ret = false;
-    char *logline = NULL;
+    const char *logline = NULL;
+    FILE *fp;
     debug_decl(do_logfile, SUDO_DEBUG_UTIL);
 
-    /* Sudo format logs and mailed logs use the same log line format. */
-    if (evl_conf->format == EVLOG_SUDO || ISSET(flags, EVLOG_MAIL)) {
-	logline = new_logline(event_type, flags, args, evlog);
+    /*
+     * Sudo format logs and mailed logs use the same log line format.
+     * Reuse the line (or JSON record) if do_syslog() already built it.
+     */
+    if (evl_conf->format == EVLOG_SUDO) {
+	if (args->logline == NULL)
+	    args->logline = new_logline(event_type, flags, args, evlog);
+	logline = args->logline;
 	if (logline == NULL)
 	    debug_return_bool(false);
-
-	if (ISSET(flags, EVLOG_MAIL)) {
-	    if (!send_mail(evlog, "%s", logline)) {
-		sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
-		    "unable to mail log line");
-	    }
-	    if (ISSET(flags, EVLOG_MAIL_ONLY)) {
-		free(logline);
-		debug_return_bool(true);
-	    }
+    }
+    if (ISSET(flags, EVLOG_MAIL)) {
+	if (logline != NULL ? !send_mail(evlog, "%s", logline) :
+		!send_mail_json(event_type, args, evlog)) {
+	    sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
+		"unable to mail log line");
 	}
+	if (ISSET(flags, EVLOG_MAIL_ONLY))
+	    debug_return_bool(true);
     }
 
+    /* Open the log file once, regardless of format. */
+    if ((fp = evl_conf->open_log(EVLOG_FILE, evl_conf->logpath)) == NULL)
+	debug_return_bool(false);
+
     switch (evl_conf->format) {
     case EVLOG_SUDO:
-	ret = do_logfile_sudo(logline ? logline : args->reason, evlog,
-	    args->event_time);
+	ret = do_logfile_sudo(evl_conf, fp, logline ? logline : args->reason,
+	    evlog, args->event_time);
 	break;
     case EVLOG_JSON:
-	ret = do_logfile_json(event_type, args, evlog);
+	ret = do_logfile_json(evl_conf, fp, event_type, args, evlog);
 	break;
     default:
 	sudo_debug_printf(SUDO_DEBUG_ERROR|SUDO_DEBUG_LINENO,
 	    "unexpected eventlog format %d", evl_conf->format);
 	break;
     }
-    free(logline);
+    evl_conf->close_log(EVLOG_FILE, fp);
 
     debug_return_bool(ret);
 }
@@ -1336,15 +1912,19 @@ eventlog_accept(const struct eventlog *evlog, int flags,
     args.json_info = info;
 
     if (ISSET(log_type, EVLOG_SYSLOG)) {
-	if (!do_syslog(EVLOG_ACCEPT, flags, &args, evlog))
+	if (!do_syslog(evl_conf, EVLOG_ACCEPT, flags, &args, evlog))
 	    ret = false;
 	CLR(flags, EVLOG_MAIL);
     }
     if (ISSET(log_type, EVLOG_FILE)) {
-	if (!do_logfile(EVLOG_ACCEPT, flags, &args, evlog))
+	if (!do_logfile(evl_conf, EVLOG_ACCEPT, flags, &args, evlog))
 	    ret = false;
     }
 
+    /* Free the shared record if the file sink did not consume it. */
+    if (args.shared_json_valid)
+	sudo_json_free(&args.shared_json);
+
     debug_return_bool(ret);
 }
 
@@ -1364,15 +1944,19 @@ eventlog_reject(const struct eventlog *evlog, int flags, const char *reason,
     args.json_info = info;
 
     if (ISSET(log_type, EVLOG_SYSLOG)) {
-	if (!do_syslog(EVLOG_REJECT, flags, &args, evlog))
+	if (!do_syslog(evl_conf, EVLOG_REJECT, flags, &args, evlog))
 	    ret = false;
 	CLR(flags, EVLOG_MAIL);
     }
     if (ISSET(log_type, EVLOG_FILE)) {
-	if (!do_logfile(EVLOG_REJECT, flags, &args, evlog))
+	if (!do_logfile(evl_conf, EVLOG_REJECT, flags, &args, evlog))
 	    ret = false;
     }
 
+    /* Free the shared record if the file sink did not consume it. */
+    if (args.shared_json_valid)
+	sudo_json_free(&args.shared_json);
+
     debug_return_bool(ret);
 }
 
@@ -1391,15 +1975,19 @@ eventlog_alert(const struct eventlog *evlog, int flags,
     args.event_time = alert_time;
 
     if (ISSET(log_type, EVLOG_SYSLOG)) {
-	if (!do_syslog(EVLOG_ALERT, flags, &args, evlog))
+	if (!do_syslog(evl_conf, EVLOG_ALERT, flags, &args, evlog))
 	    ret = false;
 	CLR(flags, EVLOG_MAIL);
     }
     if (ISSET(log_type, EVLOG_FILE)) {
-	if (!do_logfile(EVLOG_ALERT, flags, &args, evlog))
+	if (!do_logfile(evl_conf, EVLOG_ALERT, flags, &args, evlog))
 	    ret = false;
     }
 
+    /* Free the shared record if the file sink did not consume it. */
+    if (args.shared_json_valid)
+	sudo_json_free(&args.shared_json);
+
     debug_return_bool(ret);
 }
 
@@ -1419,14 +2007,18 @@ eventlog_exit(const struct eventlog *evlog, int flags)
     }
 
     if (ISSET(log_type, EVLOG_SYSLOG)) {
-	if (!do_syslog(EVLOG_EXIT, flags, &args, evlog))
+	if (!do_syslog(evl_conf, EVLOG_EXIT, flags, &args, evlog))
 	    ret = false;
 	CLR(flags, EVLOG_MAIL);
     }
     if (ISSET(log_type, EVLOG_FILE)) {
-	if (!do_logfile(EVLOG_EXIT, flags, &args, evlog))
+	if (!do_logfile(evl_conf, EVLOG_EXIT, flags, &args, evlog))
 	    ret = false;
     }
 
+    /* Free the shared record if the file sink did not consume it. */
+    if (args.shared_json_valid)
+	sudo_json_free(&args.shared_json);
+
     debug_return_bool(ret);
 }
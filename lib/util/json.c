@@ -39,6 +39,17 @@
 #include "sudo_json.h"
 #include "sudo_util.h"
 
+/*
+ * Cache of recently-released json buffers, reused by sudo_json_init_v2()
+ * to avoid a malloc()/free() cycle for each message that is formatted.
+ * The cache is not locked; sudo is single-threaded.
+ */
+#define JSON_POOL_MAX	2
+static struct json_pool_entry {
+    char *buf;
+    unsigned int bufsize;
+} json_pool[JSON_POOL_MAX];
+
 /*
  * Double the size of the json buffer.
  * Returns true on success, false if out of memory.
@@ -167,17 +178,37 @@ json_append_string(struct json_container *json, const char *str)
 }
 
 bool
-sudo_json_init_v1(struct json_container *json, int indent, bool minimal,
-    bool memfatal)
+sudo_json_init_v2(struct json_container *json, int indent, bool minimal,
+    bool memfatal, unsigned int size_hint)
 {
+    unsigned int i;
     debug_decl(sudo_json_init, SUDO_DEBUG_UTIL);
 
+    /* A hint of zero selects the historic default buffer size. */
+    if (size_hint == 0)
+	size_hint = 64 * 1024;
+    else if (size_hint < 1024)
+	size_hint = 1024;
+
     memset(json, 0, sizeof(*json));
     json->indent_level = indent;
     json->indent_increment = indent;
     json->minimal = minimal;
     json->memfatal = memfatal;
-    json->buf = malloc(64 * 1024);
+
+    /* Reuse a cached buffer if one is large enough for the hint. */
+    for (i = 0; i < JSON_POOL_MAX; i++) {
+	if (json_pool[i].buf != NULL && json_pool[i].bufsize >= size_hint) {
+	    json->buf = json_pool[i].buf;
+	    json->bufsize = json_pool[i].bufsize;
+	    json_pool[i].buf = NULL;
+	    json_pool[i].bufsize = 0;
+	    *json->buf = '\0';
+	    debug_return_bool(true);
+	}
+    }
+
+    json->buf = malloc(size_hint);
     if (json->buf == NULL) {
 	if (json->memfatal) {
 	    sudo_fatalx(U_("%s: %s"),
@@ -188,17 +219,36 @@ sudo_json_init_v1(struct json_container *json, int indent, bool minimal,
 	debug_return_bool(false);
     }
     *json->buf = '\0';
-    json->bufsize = 64 * 1024;
+    json->bufsize = size_hint;
 
     debug_return_bool(true);
 }
 
+bool
+sudo_json_init_v1(struct json_container *json, int indent, bool minimal,
+    bool memfatal)
+{
+    return sudo_json_init_v2(json, indent, minimal, memfatal, 0);
+}
+
 void
 sudo_json_free_v1(struct json_container *json)
 {
+    unsigned int i;
     debug_decl(sudo_json_free, SUDO_DEBUG_UTIL);
 
-    free(json->buf);
+    /* Stash the buffer for reuse if there is a free slot in the cache. */
+    if (json->buf != NULL) {
+	for (i = 0; i < JSON_POOL_MAX; i++) {
+	    if (json_pool[i].buf == NULL) {
+		json_pool[i].buf = json->buf;
+		json_pool[i].bufsize = json->bufsize;
+		json->buf = NULL;
+		break;
+	    }
+	}
+	free(json->buf);
+    }
     memset(json, 0, sizeof(*json));
 
     debug_return;
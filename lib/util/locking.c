@@ -52,7 +52,53 @@ sudo_lock_file_v1(int fd, int type)
 /*
  * Lock/unlock all or part of a file.
  */
-#ifdef HAVE_LOCKF
+#if defined(F_OFD_SETLK) && defined(F_OFD_SETLKW)
+/*
+ * Open file description locks are owned by the open file description,
+ * not the process, so they are not lost when an unrelated fd to the
+ * same file is closed.  They conflict with classic POSIX record locks
+ * so older sudo processes using fcntl() locks still interoperate.
+ */
+bool
+sudo_lock_region_v1(int fd, int type, off_t len)
+{
+    struct flock lock;
+    int func;
+    debug_decl(sudo_lock_region, SUDO_DEBUG_UTIL);
+
+    switch (type) {
+	case SUDO_LOCK:
+	    sudo_debug_printf(SUDO_DEBUG_INFO, "%s: lock %d:%lld",
+		__func__, fd, (long long)len);
+	    lock.l_type = F_WRLCK;
+	    func = F_OFD_SETLKW;
+	    break;
+	case SUDO_TLOCK:
+	    sudo_debug_printf(SUDO_DEBUG_INFO, "%s: tlock %d:%lld",
+		__func__, fd, (long long)len);
+	    lock.l_type = F_WRLCK;
+	    func = F_OFD_SETLK;
+	    break;
+	case SUDO_UNLOCK:
+	    sudo_debug_printf(SUDO_DEBUG_INFO, "%s: unlock %d:%lld",
+		__func__, fd, (long long)len);
+	    lock.l_type = F_UNLCK;
+	    func = F_OFD_SETLK;
+	    break;
+	default:
+	    sudo_debug_printf(SUDO_DEBUG_INFO, "%s: bad lock type %d",
+		__func__, type);
+	    errno = EINVAL;
+	    debug_return_bool(false);
+    }
+    lock.l_start = 0;
+    lock.l_len = len;
+    lock.l_pid = 0;		/* must be 0 for OFD locks */
+    lock.l_whence = len ? SEEK_CUR : SEEK_SET;
+
+    debug_return_bool(fcntl(fd, func, &lock) == 0);
+}
+#elif defined(HAVE_LOCKF)
 bool
 sudo_lock_region_v1(int fd, int type, off_t len)
 {
@@ -28,23 +28,65 @@
 
 #include <sys/types.h>
 
+#include <limits.h>
+#ifdef HAVE_STDINT_H
+# include <stdint.h>
+#else
+# include <inttypes.h>
+#endif
+#include <string.h>
+
 #include "sudo_compat.h"
 
+/* Repeat the low byte through an unsigned long (0x0101...) and the
+ * corresponding high-bit mask (0x8080...) for the zero-byte test. */
+#define MEMRCHR_LO	((unsigned long)-1 / UCHAR_MAX)
+#define MEMRCHR_HI	(MEMRCHR_LO * (UCHAR_MAX / 2 + 1))
+
 /*
  * Reverse memchr()
  * Find the last occurrence of 'c' in the buffer 's' of size 'n'.
+ * Scans a word at a time once aligned, using the carry trick to
+ * detect a matching byte in the word.
  */
 void *
 sudo_memrchr(const void *s, int c, size_t n)
 {
-    const unsigned char *cp;
-
-    if (n != 0) {
-	cp = (unsigned char *)s + n;
-	do {
-	    if (*(--cp) == (unsigned char)c)
-		return (void *)cp;
-	} while (--n != 0);
+    const unsigned char *cp = (const unsigned char *)s + n;
+    const unsigned char uc = (unsigned char)c;
+    const unsigned long mask = MEMRCHR_LO * uc;
+
+    /* Scan backward a byte at a time until cp is word-aligned. */
+    while (n != 0 && ((uintptr_t)cp & (sizeof(unsigned long) - 1)) != 0) {
+	if (*--cp == uc)
+	    return (void *)cp;
+	n--;
+    }
+
+    /* Scan a word at a time, stopping at a word with a matching byte. */
+    while (n >= sizeof(unsigned long)) {
+	unsigned long w;
+
+	memcpy(&w, cp - sizeof(unsigned long), sizeof(w));
+	w ^= mask;
+	if (((w - MEMRCHR_LO) & ~w & MEMRCHR_HI) != 0) {
+	    /* Match is in this word, locate it by byte. */
+	    size_t i = sizeof(unsigned long);
+	    while (i-- != 0) {
+		if (*--cp == uc)
+		    return (void *)cp;
+	    }
+	    /* NOTREACHED */
+	}
+	cp -= sizeof(unsigned long);
+	n -= sizeof(unsigned long);
+    }
+
+    /* Scan any remaining bytes. */
+    while (n != 0) {
+	if (*--cp == uc)
+	    return (void *)cp;
+	n--;
     }
     return (void *)0;
 }
@@ -195,18 +195,26 @@ check_user(int validated, int mode)
 	ret = true;
 	goto done;
     }
-    if (user_uid == 0 || (user_uid == runas_pw->pw_uid &&
-	(!runas_gr || user_in_group(sudo_user.pw, runas_gr->gr_name)))) {
+    if (user_uid == 0 || user_uid == runas_pw->pw_uid) {
+	bool running_as_self = true;
+
+	/* Check the cheap subsystem tests before the group query. */
 #ifdef HAVE_SELINUX
-	if (user_role == NULL && user_type == NULL)
+	if (user_role != NULL || user_type != NULL)
+	    running_as_self = false;
 #endif
 #ifdef HAVE_APPARMOR
-	if (user_apparmor_profile == NULL)
+	if (user_apparmor_profile != NULL)
+	    running_as_self = false;
 #endif
 #ifdef HAVE_PRIV_SET
-	if (runas_privs == NULL && runas_limitprivs == NULL)
+	if (runas_privs != NULL || runas_limitprivs != NULL)
+	    running_as_self = false;
 #endif
-	{
+	if (running_as_self && user_uid != 0 && runas_gr != NULL &&
+		!user_in_group(sudo_user.pw, runas_gr->gr_name))
+	    running_as_self = false;
+	if (running_as_self) {
 	    sudo_debug_printf(SUDO_DEBUG_INFO,
 		"%s: user running command as self", __func__);
 	    ret = true;
@@ -245,6 +253,7 @@ done:
 void
 display_lecture(struct sudo_conv_callback *callback)
 {
+    static const char *default_lecture;
     struct getpass_closure *closure;
     struct sudo_conv_message msg;
     struct sudo_conv_reply repl;
@@ -267,19 +276,57 @@ display_lecture(struct sudo_conv_callback *callback)
     memset(&repl, 0, sizeof(repl));
 
     if (def_lecture_file) {
-	fd = open(def_lecture_file, O_RDONLY|O_NONBLOCK);
+	fd = open(def_lecture_file, O_RDONLY|O_NONBLOCK|O_CLOEXEC);
 	if (fd != -1 && fstat(fd, &sb) == 0) {
 	    if (S_ISREG(sb.st_mode)) {
+		char *fbuf = NULL;
+
 		(void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
-		while ((nread = read(fd, buf, sizeof(buf) - 1)) > 0) {
-		    buf[nread] = '\0';
-		    msg.msg_type = SUDO_CONV_ERROR_MSG|SUDO_CONV_PREFER_TTY;
-		    msg.msg = buf;
-		    sudo_conv(1, &msg, &repl, NULL);
-		}
-		if (nread == 0) {
-		    close(fd);
-		    goto done;
+#ifdef POSIX_FADV_SEQUENTIAL
+		/* We read the file sequentially and only once. */
+		(void) posix_fadvise(fd, 0, sb.st_size,
+		    POSIX_FADV_SEQUENTIAL);
+#endif
+		/*
+		 * Display a reasonably-sized lecture with a single
+		 * conversation call instead of one call per BUFSIZ chunk.
+		 */
+		if (sb.st_size > 0 && sb.st_size < 1024 * 1024)
+		    fbuf = malloc((size_t)sb.st_size + 1);
+		if (fbuf != NULL) {
+		    size_t filled = 0;
+
+		    while (filled < (size_t)sb.st_size) {
+			nread = read(fd, fbuf + filled,
+			    (size_t)sb.st_size - filled);
+			if (nread <= 0)
+			    break;
+			filled += (size_t)nread;
+		    }
+		    if (nread >= 0) {
+			if (filled != 0) {
+			    fbuf[filled] = '\0';
+			    msg.msg_type =
+				SUDO_CONV_ERROR_MSG|SUDO_CONV_PREFER_TTY;
+			    msg.msg = fbuf;
+			    sudo_conv(1, &msg, &repl, NULL);
+			}
+			free(fbuf);
+			close(fd);
+			goto done;
+		    }
+		    free(fbuf);
+		} else {
+		    while ((nread = read(fd, buf, sizeof(buf) - 1)) > 0) {
+			buf[nread] = '\0';
+			msg.msg_type = SUDO_CONV_ERROR_MSG|SUDO_CONV_PREFER_TTY;
+			msg.msg = buf;
+			sudo_conv(1, &msg, &repl, NULL);
+		    }
+		    if (nread == 0) {
+			close(fd);
+			goto done;
+		    }
 		}
 		log_warning(SLOG_RAW_MSG,
 		    N_("error reading lecture file %s"), def_lecture_file);
@@ -296,14 +343,17 @@ display_lecture(struct sudo_conv_callback *callback)
 	    close(fd);
     }
 
-    /* Default sudo lecture. */
+    /* Default sudo lecture, translated at most once. */
+    if (default_lecture == NULL) {
+	default_lecture = _("\n"
+	    "We trust you have received the usual lecture from the local System\n"
+	    "Administrator. It usually boils down to these three things:\n\n"
+	    "    #1) Respect the privacy of others.\n"
+	    "    #2) Think before you type.\n"
+	    "    #3) With great power comes great responsibility.\n\n");
+    }
     msg.msg_type = SUDO_CONV_ERROR_MSG|SUDO_CONV_PREFER_TTY;
-    msg.msg = _("\n"
-	"We trust you have received the usual lecture from the local System\n"
-	"Administrator. It usually boils down to these three things:\n\n"
-	"    #1) Respect the privacy of others.\n"
-	"    #2) Think before you type.\n"
-	"    #3) With great power comes great responsibility.\n\n");
+    msg.msg = default_lecture;
     sudo_conv(1, &msg, &repl, NULL);
 
 done:
@@ -376,21 +426,38 @@ get_authpw(int mode)
 bool
 check_user_shell(const struct passwd *pw)
 {
+    static char *cached_shell;
+    static bool cached_ret;
     const char *shell;
+    bool ret = false;
     debug_decl(check_user_shell, SUDOERS_DEBUG_AUTH);
 
     if (!def_runas_check_shell)
 	debug_return_bool(true);
 
+    /*
+     * The policy may be checked multiple times in a single process,
+     * e.g. for each command when running in intercept mode.  Cache the
+     * result so repeated checks of the same shell skip /etc/shells.
+     */
+    if (cached_shell != NULL && strcmp(cached_shell, pw->pw_shell) == 0)
+	debug_return_bool(cached_ret);
+
     sudo_debug_printf(SUDO_DEBUG_INFO,
 	"%s: checking /etc/shells for %s", __func__, pw->pw_shell);
 
     setusershell();
     while ((shell = getusershell()) != NULL) {
-	if (strcmp(shell, pw->pw_shell) == 0)
-	    debug_return_bool(true);
+	if (strcmp(shell, pw->pw_shell) == 0) {
+	    ret = true;
+	    break;
+	}
     }
     endusershell();
 
-    debug_return_bool(false);
+    free(cached_shell);
+    if ((cached_shell = strdup(pw->pw_shell)) != NULL)
+	cached_ret = ret;
+
+    debug_return_bool(ret);
 }
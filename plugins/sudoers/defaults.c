@@ -80,6 +80,28 @@ static bool defaults_warnx(const char *file, int line, int column, bool quiet, c
  */
 #include <def_data.c>
 
+/*
+ * Indexes into sudo_defs_table[], sorted by name, built on demand.
+ * The table itself is generated in declaration order so it cannot
+ * be searched directly.
+ */
+static int *def_sorted;
+static int num_defs;
+
+static int
+def_sort_cmp(const void *v1, const void *v2)
+{
+    return strcmp(sudo_defs_table[*(const int *)v1].name,
+	sudo_defs_table[*(const int *)v2].name);
+}
+
+static int
+def_search_cmp(const void *key, const void *elt)
+{
+    return strcmp((const char *)key,
+	sudo_defs_table[*(const int *)elt].name);
+}
+
 /*
  * Print version and configure info.
  */
@@ -182,9 +204,27 @@ find_default(const char *name, const char *file, int line, int column, bool quie
     int i;
     debug_decl(find_default, SUDOERS_DEBUG_DEFAULTS);
 
-    for (i = 0; sudo_defs_table[i].name != NULL; i++) {
-	if (strcmp(name, sudo_defs_table[i].name) == 0)
-	    debug_return_int(i);
+    if (def_sorted == NULL) {
+	while (sudo_defs_table[num_defs].name != NULL)
+	    num_defs++;
+	def_sorted = reallocarray(NULL, num_defs, sizeof(int));
+	if (def_sorted != NULL) {
+	    for (i = 0; i < num_defs; i++)
+		def_sorted[i] = i;
+	    qsort(def_sorted, num_defs, sizeof(int), def_sort_cmp);
+	}
+    }
+    if (def_sorted != NULL) {
+	const int *found = bsearch(name, def_sorted, num_defs, sizeof(int),
+	    def_search_cmp);
+	if (found != NULL)
+	    debug_return_int(*found);
+    } else {
+	/* Unable to allocate the sorted index, search the table directly. */
+	for (i = 0; sudo_defs_table[i].name != NULL; i++) {
+	    if (strcmp(name, sudo_defs_table[i].name) == 0)
+		debug_return_int(i);
+	}
     }
     if (!def_ignore_unknown_defaults) {
 	defaults_warnx(file, line, column, quiet,
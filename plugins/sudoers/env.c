@@ -374,7 +374,7 @@ sudo_putenv_nodebug(char *str, bool dupcheck, bool overwrite)
     if (dupcheck) {
 	size_t len = (size_t)(equal - str) + 1;
 	for (ep = env.envp; *ep != NULL; ep++) {
-	    if (strncmp(str, *ep, len) == 0) {
+	    if (**ep == *str && strncmp(str, *ep, len) == 0) {
 		if (overwrite)
 		    *ep = str;
 		found = true;
@@ -384,7 +384,7 @@ sudo_putenv_nodebug(char *str, bool dupcheck, bool overwrite)
 	/* Prune out extra instances of the variable we just overwrote. */
 	if (found && overwrite) {
 	    while (*++ep != NULL) {
-		if (strncmp(str, *ep, len) == 0) {
+		if (**ep == *str && strncmp(str, *ep, len) == 0) {
 		    char **cur = ep;
 		    while ((*cur = *(cur + 1)) != NULL)
 			cur++;
@@ -493,7 +493,7 @@ sudo_unsetenv_nodebug(const char *var)
 
     len = strlen(var);
     while (*ep != NULL) {
-	if (strncmp(var, *ep, len) == 0 && (*ep)[len] == '=') {
+	if (**ep == *var && strncmp(var, *ep, len) == 0 && (*ep)[len] == '=') {
 	    /* Found it; shift remainder + NULL over by one. */
 	    char **cur = ep;
 	    while ((*cur = *(cur + 1)) != NULL)
@@ -538,7 +538,8 @@ sudo_getenv_nodebug(const char *name)
 	while (name[namelen] != '\0' && name[namelen] != '=')
 	    namelen++;
 	for (ep = env.envp; *ep != NULL; ep++) {
-	    if (strncmp(*ep, name, namelen) == 0 && (*ep)[namelen] == '=') {
+	    if (**ep == *name && strncmp(*ep, name, namelen) == 0 &&
+		    (*ep)[namelen] == '=') {
 		val = *ep + namelen + 1;
 		break;
 	    }
@@ -1261,9 +1262,7 @@ env_file_next_local(void *cookie, int *errnum)
 	}
 
 	/* Must be of the form name=["']value['"] */
-	for (val = var; *val != '\0' && *val != '='; val++)
-	    continue;
-	if (var == val || *val != '=')
+	if ((val = strchr(var, '=')) == NULL || val == var)
 	    continue;
 	var_len = (size_t)(val - var);
 	val_len = strlen(++val);
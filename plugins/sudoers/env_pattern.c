@@ -43,11 +43,10 @@ matches_env_pattern(const char *pattern, const char *var, bool *full_match)
     sep_pos = strcspn(var, "=");
 
     /* Locate '*' wildcard and compute len. */
-    for (cp = pattern; *cp != '\0'; cp++) {
-	if (*cp == '*') {
-	    iswild = true;
-	    break;
-	}
+    if ((cp = strchr(pattern, '*')) != NULL) {
+	iswild = true;
+    } else {
+	cp = pattern + strlen(pattern);
     }
     len = (size_t)(cp - pattern);
 
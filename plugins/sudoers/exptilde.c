@@ -43,7 +43,7 @@ expand_tilde(char **path, const char *user)
     char *npath, *opath = *path;
     char *slash = NULL;
     struct passwd *pw;
-    int len;
+    size_t dlen, olen;
     debug_decl(expand_tilde, SUDOERS_DEBUG_UTIL);
 
     switch (*opath++) {
@@ -86,12 +86,21 @@ expand_tilde(char **path, const char *user)
 	debug_return_bool(false);
     }
 
-    len = asprintf(&npath, "%s%s%s", pw->pw_dir, *opath ? "/" : "", opath);
-    sudo_pw_delref(pw);
-    if (len == -1) {
+    /* Build the expansion with a single allocation: home[/rest] */
+    dlen = strlen(pw->pw_dir);
+    olen = strlen(opath);
+    if ((npath = malloc(dlen + olen + 2)) == NULL) {
+	sudo_pw_delref(pw);
 	sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
 	debug_return_bool(false);
     }
+    memcpy(npath, pw->pw_dir, dlen);
+    if (olen != 0) {
+	npath[dlen++] = '/';
+	memcpy(npath + dlen, opath, olen);
+    }
+    npath[dlen + olen] = '\0';
+    sudo_pw_delref(pw);
 
     free(*path);
     *path = npath;
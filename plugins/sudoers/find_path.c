@@ -92,6 +92,9 @@ find_path(const char *infile, char **outfile, struct stat *sbp,
 {
     char command[PATH_MAX];
     const char *cp, *ep, *pathend;
+    const char *seen[64];
+    size_t seen_len[64];
+    unsigned int i, nseen = 0;
     bool found = false;
     bool checkdot = false;
     int len;
@@ -130,6 +133,19 @@ find_path(const char *infile, char **outfile, struct stat *sbp,
 	    continue;
 	}
 
+	/* Skip directories already checked (duplicate $PATH entries). */
+	for (i = 0; i < nseen; i++) {
+	    if (seen_len[i] == (size_t)(ep - cp) &&
+		    strncmp(seen[i], cp, seen_len[i]) == 0)
+		break;
+	}
+	if (i < nseen)
+	    continue;
+	if (nseen < nitems(seen)) {
+	    seen[nseen] = cp;
+	    seen_len[nseen++] = (size_t)(ep - cp);
+	}
+
 	/*
 	 * Resolve the path and exit the loop if found.
 	 */
@@ -40,6 +40,53 @@ static void *group_handle;
 static struct sudoers_group_plugin *group_plugin;
 const char *path_plugin_dir = _PATH_SUDO_PLUGIN_DIR;
 
+/*
+ * Cache of plugin query results; the same (user, group) pair is often
+ * queried repeatedly when multiple sudoers rules refer to a non-local
+ * group and the plugin may need to contact a directory server for each
+ * query.  Direct-mapped, flushed when the plugin is unloaded.
+ */
+#define GROUP_CACHE_SIZE	256
+
+static struct group_cache_entry {
+    char *user;
+    char *group;
+    int result;
+} group_cache[GROUP_CACHE_SIZE];
+
+static unsigned int
+group_cache_hash(const char *user, const char *group)
+{
+    unsigned int hash = 2166136261U;
+
+    /* FNV-1a of user '\0' group. */
+    while (*user != '\0') {
+	hash ^= (unsigned char)*user++;
+	hash *= 16777619U;
+    }
+    hash *= 16777619U;
+    while (*group != '\0') {
+	hash ^= (unsigned char)*group++;
+	hash *= 16777619U;
+    }
+    return hash;
+}
+
+static void
+group_cache_flush(void)
+{
+    unsigned int i;
+    debug_decl(group_cache_flush, SUDOERS_DEBUG_UTIL);
+
+    for (i = 0; i < GROUP_CACHE_SIZE; i++) {
+	free(group_cache[i].user);
+	free(group_cache[i].group);
+	group_cache[i].user = NULL;
+	group_cache[i].group = NULL;
+    }
+    debug_return;
+}
+
 /*
  * Check for a fallback path when the original group plugin is not loadable.
  * Returns true on success, rewriting path and filling in sb, else false.
@@ -267,6 +314,7 @@ group_plugin_unload(void)
 	sudo_dso_unload(group_handle);
 	group_handle = NULL;
     }
+    group_cache_flush();
     debug_return;
 }
 
@@ -274,11 +322,39 @@ int
 group_plugin_query(const char *user, const char *group,
     const struct passwd *pwd)
 {
+    struct group_cache_entry *ent;
+    int rc;
     debug_decl(group_plugin_query, SUDOERS_DEBUG_UTIL);
 
     if (group_plugin == NULL)
 	debug_return_int(false);
-    debug_return_int((group_plugin->query)(user, group, pwd));
+
+    ent = &group_cache[group_cache_hash(user, group) & (GROUP_CACHE_SIZE - 1)];
+    if (ent->user != NULL && strcmp(user, ent->user) == 0 &&
+	    strcmp(group, ent->group) == 0) {
+	sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
+	    "%s: cached result for (%s, %s): %d", __func__, user, group,
+	    ent->result);
+	debug_return_int(ent->result);
+    }
+
+    rc = (group_plugin->query)(user, group, pwd);
+
+    /* Cache the result; on allocation failure just leave the slot empty. */
+    free(ent->user);
+    free(ent->group);
+    ent->user = strdup(user);
+    ent->group = strdup(group);
+    if (ent->user == NULL || ent->group == NULL) {
+	free(ent->user);
+	free(ent->group);
+	ent->user = NULL;
+	ent->group = NULL;
+    } else {
+	ent->result = rc;
+    }
+
+    debug_return_int(rc);
 }
 
 #else /* !HAVE_DLOPEN && !HAVE_SHL_LOAD */
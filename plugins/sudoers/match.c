@@ -35,6 +35,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_STDINT_H
+# include <stdint.h>
+#else
+# include <inttypes.h>
+#endif
 #ifdef HAVE_STRINGS_H
 # include <strings.h>
 #endif /* HAVE_STRINGS_H */
@@ -414,6 +419,59 @@ cmnd_matches(struct sudoers_parse_tree *parse_tree, const struct member *m,
     debug_return_int(matched);
 }
 
+/* Repeat a byte through a 64-bit word and the per-lane high-bit mask. */
+#define HOSTCMP_ONES	UINT64_C(0x0101010101010101)
+#define HOSTCMP_HI	UINT64_C(0x8080808080808080)
+
+/*
+ * Case-insensitive hostname comparison, a word at a time.
+ * Host names are ASCII in practice; lower-case the A-Z lanes via the
+ * usual SWAR range test and compare eight bytes per iteration.
+ * Falls back to strcasecmp() if a non-ASCII byte is seen since that
+ * may be subject to locale-dependent case folding.
+ */
+static bool
+hostcasematch(const char *s1, const char *s2)
+{
+    const size_t len = strlen(s1);
+    size_t i = 0;
+
+    if (len != strlen(s2))
+	return false;
+
+    while (len - i >= sizeof(uint64_t)) {
+	uint64_t w1, w2, upper1, upper2;
+
+	memcpy(&w1, s1 + i, sizeof(w1));
+	memcpy(&w2, s2 + i, sizeof(w2));
+	if (((w1 | w2) & HOSTCMP_HI) != 0)
+	    return strcasecmp(s1 + i, s2 + i) == 0;
+	/* High bit set in lanes holding 'A' - 'Z' (no carry, bytes < 0x80). */
+	upper1 = (w1 + 0x3f * HOSTCMP_ONES) & ~(w1 + 0x25 * HOSTCMP_ONES);
+	upper2 = (w2 + 0x3f * HOSTCMP_ONES) & ~(w2 + 0x25 * HOSTCMP_ONES);
+	w1 |= (upper1 & HOSTCMP_HI) >> 2;	/* 0x80 -> 0x20 */
+	w2 |= (upper2 & HOSTCMP_HI) >> 2;
+	if (w1 != w2)
+	    return false;
+	i += sizeof(uint64_t);
+    }
+    while (i < len) {
+	unsigned char ch1 = (unsigned char)s1[i];
+	unsigned char ch2 = (unsigned char)s2[i];
+
+	if ((ch1 | ch2) & 0x80)
+	    return strcasecmp(s1 + i, s2 + i) == 0;
+	if (ch1 >= 'A' && ch1 <= 'Z')
+	    ch1 |= 0x20;
+	if (ch2 >= 'A' && ch2 <= 'Z')
+	    ch2 |= 0x20;
+	if (ch1 != ch2)
+	    return false;
+	i++;
+    }
+    return true;
+}
+
 /*
  * Returns true if the hostname matches the pattern, else false
  */
@@ -428,7 +486,7 @@ hostname_matches(const char *shost, const char *lhost, const char *pattern)
     if (has_meta(pattern)) {
 	rc = !fnmatch(pattern, host, FNM_CASEFOLD);
     } else {
-	rc = !strcasecmp(host, pattern);
+	rc = hostcasematch(host, pattern);
     }
     sudo_debug_printf(SUDO_DEBUG_DEBUG|SUDO_DEBUG_LINENO,
 	"host %s matches sudoers pattern %s: %s",
@@ -35,6 +35,19 @@
 
 #include "sudoers.h"
 
+/*
+ * Cache of the most recent expansion.  In intercept mode the prompt
+ * is re-expanded with identical inputs for each sub-command; the
+ * other escapes (%h, %H, %u) only depend on values that are fixed
+ * for the life of the process.
+ */
+static struct prompt_cache {
+    char *old_prompt;
+    char *auth_user;
+    char *runas_user;
+    char *new_prompt;
+} prompt_cache;
+
 /*
  * Expand %h and %u escapes (if present) in the prompt and pass back
  * the dynamically allocated result.
@@ -48,6 +61,16 @@ expand_prompt(const char *old_prompt, const char *auth_user)
     char *np, *new_prompt;
     debug_decl(expand_prompt, SUDOERS_DEBUG_AUTH);
 
+    if (prompt_cache.new_prompt != NULL && auth_user != NULL &&
+	    runas_pw != NULL &&
+	    strcmp(old_prompt, prompt_cache.old_prompt) == 0 &&
+	    strcmp(auth_user, prompt_cache.auth_user) == 0 &&
+	    strcmp(runas_pw->pw_name, prompt_cache.runas_user) == 0) {
+	if ((new_prompt = strdup(prompt_cache.new_prompt)) == NULL)
+	    sudo_warnx(U_("%s: %s"), __func__, U_("unable to allocate memory"));
+	debug_return_str(new_prompt);
+    }
+
     /* How much space do we need to malloc for the prompt? */
     subst = 0;
     for (p = old_prompt, len = strlen(old_prompt); *p != '\0'; p++) {
@@ -160,6 +183,23 @@ expand_prompt(const char *old_prompt, const char *auth_user)
 	memcpy(new_prompt, old_prompt, len);	/* len includes NUL */
     }
 
+    /* Cache the result for the next call; on failure just don't cache. */
+    if (auth_user != NULL && runas_pw != NULL) {
+	free(prompt_cache.old_prompt);
+	free(prompt_cache.auth_user);
+	free(prompt_cache.runas_user);
+	free(prompt_cache.new_prompt);
+	prompt_cache.old_prompt = strdup(old_prompt);
+	prompt_cache.auth_user = strdup(auth_user);
+	prompt_cache.runas_user = strdup(runas_pw->pw_name);
+	prompt_cache.new_prompt = strdup(new_prompt);
+	if (prompt_cache.old_prompt == NULL || prompt_cache.auth_user == NULL ||
+		prompt_cache.runas_user == NULL) {
+	    free(prompt_cache.new_prompt);
+	    prompt_cache.new_prompt = NULL;
+	}
+    }
+
     debug_return_str(new_prompt);
 
 oflow:
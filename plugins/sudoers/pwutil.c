@@ -102,6 +102,23 @@ sudo_pwutil_set_backend(sudo_make_pwitem_t pwitem, sudo_make_gritem_t gritem,
     debug_return;
 }
 
+/*
+ * 32-bit FNV-1a hash of a key name.  The by-name caches order entries
+ * by this hash first so most comparisons during a tree descent are a
+ * single integer test instead of a strcmp().
+ */
+static unsigned int
+name_hash(const char *name)
+{
+    unsigned int h = 2166136261U;
+
+    while (*name != '\0') {
+	h ^= (unsigned char)*name++;
+	h *= 16777619U;
+    }
+    return h;
+}
+
 /*
  * Compare by user-ID.
  * v1 is the key to find or data to insert, v2 is in-tree data.
@@ -127,7 +144,10 @@ cmp_pwnam(const void *v1, const void *v2)
 {
     const struct cache_item *ci1 = (const struct cache_item *) v1;
     const struct cache_item *ci2 = (const struct cache_item *) v2;
-    int ret = strcmp(ci1->k.name, ci2->k.name);
+    int ret;
+    if (ci1->hash != ci2->hash)
+	return ci1->hash < ci2->hash ? -1 : 1;
+    ret = strcmp(ci1->k.name, ci2->k.name);
     if (ret == 0)
 	ret = strcmp(ci1->registry, ci2->registry);
     return ret;
@@ -144,7 +164,10 @@ cmp_gidlist(const void *v1, const void *v2)
 {
     const struct cache_item *ci1 = (const struct cache_item *) v1;
     const struct cache_item *ci2 = (const struct cache_item *) v2;
-    int ret = strcmp(ci1->k.name, ci2->k.name);
+    int ret;
+    if (ci1->hash != ci2->hash)
+	return ci1->hash < ci2->hash ? -1 : 1;
+    ret = strcmp(ci1->k.name, ci2->k.name);
     if (ret == 0) {
 	if (ci1->type == ENTRY_TYPE_ANY || ci1->type == ci2->type)
 	    return strcmp(ci1->registry, ci2->registry);
@@ -273,6 +296,7 @@ sudo_getpwnam(const char *name)
     }
 
     key.k.name = (char *) name;
+    key.hash = name_hash(name);
     getauthregistry((char *) name, key.registry);
     if ((node = rbfind(pwcache_byname, &key)) != NULL) {
 	item = node->data;
@@ -300,6 +324,7 @@ sudo_getpwnam(const char *name)
 	memcpy(item->k.name, name, len);
 	/* item->d.pw = NULL; */
     }
+    item->hash = key.hash;
     strlcpy(item->registry, key.registry, sizeof(item->registry));
     switch (rbinsert(pwcache_byname, item, NULL)) {
     case 1:
@@ -399,6 +424,7 @@ sudo_mkpwent(const char *user, uid_t uid, gid_t gid, const char *home,
 	} else {
 	    /* Store by name. */
 	    item->k.name = pw->pw_name;
+	    item->hash = name_hash(pw->pw_name);
 	    pwcache = pwcache_byname;
 	}
 	getauthregistry(NULL, item->registry);
@@ -590,6 +616,7 @@ sudo_getgrnam(const char *name)
     }
 
     key.k.name = (char *) name;
+    key.hash = name_hash(name);
     getauthregistry(NULL, key.registry);
     if ((node = rbfind(grcache_byname, &key)) != NULL) {
 	item = node->data;
@@ -611,6 +638,7 @@ sudo_getgrnam(const char *name)
 	memcpy(item->k.name, name, len);
 	/* item->d.gr = NULL; */
     }
+    item->hash = key.hash;
     strlcpy(item->registry, key.registry, sizeof(item->registry));
     switch (rbinsert(grcache_byname, item, NULL)) {
     case 1:
@@ -712,6 +740,7 @@ sudo_mkgrent(const char *group, gid_t gid, ...)
 	} else {
 	    /* Store by name, overwriting cached version. */
 	    gritem->cache.k.name = gr->gr_name;
+	    gritem->cache.hash = name_hash(gr->gr_name);
 	    grcache = grcache_byname;
 	}
 	getauthregistry(NULL, item->registry);
@@ -860,6 +889,7 @@ sudo_get_grlist(const struct passwd *pw)
     }
 
     key.k.name = pw->pw_name;
+    key.hash = name_hash(pw->pw_name);
     getauthregistry(pw->pw_name, key.registry);
     if ((node = rbfind(grlist_cache, &key)) != NULL) {
 	item = node->data;
@@ -873,6 +903,7 @@ sudo_get_grlist(const struct passwd *pw)
 	/* Out of memory? */
 	debug_return_ptr(NULL);
     }
+    item->hash = key.hash;
     strlcpy(item->registry, key.registry, sizeof(item->registry));
     switch (rbinsert(grlist_cache, item, NULL)) {
     case 1:
@@ -919,12 +950,14 @@ sudo_set_grlist(struct passwd *pw, char * const *groups)
      * Cache group db entry if it doesn't already exist
      */
     key.k.name = pw->pw_name;
+    key.hash = name_hash(pw->pw_name);
     getauthregistry(NULL, key.registry);
     if (rbfind(grlist_cache, &key) == NULL) {
 	if ((item = make_grlist_item(pw, groups)) == NULL) {
 	    sudo_warnx(U_("unable to parse groups for %s"), pw->pw_name);
 	    debug_return_int(-1);
 	}
+	item->hash = key.hash;
 	strlcpy(item->registry, key.registry, sizeof(item->registry));
 	switch (rbinsert(grlist_cache, item, NULL)) {
 	case 1:
@@ -960,6 +993,7 @@ sudo_get_gidlist(const struct passwd *pw, unsigned int type)
     }
 
     key.k.name = pw->pw_name;
+    key.hash = name_hash(pw->pw_name);
     key.type = type;
     getauthregistry(pw->pw_name, key.registry);
     if ((node = rbfind(gidlist_cache, &key)) != NULL) {
@@ -974,6 +1008,7 @@ sudo_get_gidlist(const struct passwd *pw, unsigned int type)
 	/* Out of memory? */
 	debug_return_ptr(NULL);
     }
+    item->hash = key.hash;
     strlcpy(item->registry, key.registry, sizeof(item->registry));
     switch (rbinsert(gidlist_cache, item, NULL)) {
     case 1:
@@ -1020,6 +1055,7 @@ sudo_set_gidlist(struct passwd *pw, char * const *gids, unsigned int type)
      * Cache group db entry if it doesn't already exist
      */
     key.k.name = pw->pw_name;
+    key.hash = name_hash(pw->pw_name);
     key.type = type;
     getauthregistry(NULL, key.registry);
     if (rbfind(gidlist_cache, &key) == NULL) {
@@ -1027,6 +1063,7 @@ sudo_set_gidlist(struct passwd *pw, char * const *gids, unsigned int type)
 	    sudo_warnx(U_("unable to parse gids for %s"), pw->pw_name);
 	    debug_return_int(-1);
 	}
+	item->hash = key.hash;
 	strlcpy(item->registry, key.registry, sizeof(item->registry));
 	switch (rbinsert(gidlist_cache, item, NULL)) {
 	case 1:
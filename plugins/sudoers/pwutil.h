@@ -27,6 +27,7 @@
 struct cache_item {
     unsigned int refcnt;
     unsigned int type;	/* only used for gidlist */
+    unsigned int hash;	/* of k.name, only used for by-name caches */
     char registry[16];	/* AIX-specific, empty otherwise */
     /* key */
     union {
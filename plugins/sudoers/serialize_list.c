@@ -56,15 +56,25 @@ serialize_list(const char *varname, struct list_members *members)
     len = strlcpy(result, varname, result_size);
     result[len++] = '=';
     SLIST_FOREACH_SAFE(lm, members, entries, next) {
-	for (cp = lm->value; *cp != '\0'; cp++) {
-	    bool escape = (*cp == '\\' || *cp == ',');
-	    if (len + 1 + escape >= result_size) {
+	cp = lm->value;
+	for (;;) {
+	    /* Bulk-copy the span up to the next character to escape. */
+	    size_t seg = strcspn(cp, "\\,");
+	    if (seg >= result_size - len) {
+		sudo_warnx(U_("internal error, %s overflow"), __func__);
+		goto bad;
+	    }
+	    memcpy(result + len, cp, seg);
+	    len += seg;
+	    cp += seg;
+	    if (*cp == '\0')
+		break;
+	    if (len + 2 >= result_size) {
 		sudo_warnx(U_("internal error, %s overflow"), __func__);
 		goto bad;
 	    }
-	    if (escape)
-		result[len++] = '\\';
-	    result[len++] = *cp;
+	    result[len++] = '\\';
+	    result[len++] = *cp++;
 	}
 	if (next != NULL) {
 	    if (len + 1 >= result_size) {
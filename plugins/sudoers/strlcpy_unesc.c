@@ -25,6 +25,7 @@
 
 #include <sys/types.h>
 #include <stdio.h>
+#include <string.h>
 #include <ctype.h>
 
 #include "sudoers.h"
@@ -36,8 +37,25 @@ strlcpy_unescape(char *dst, const char *src, size_t size)
     char ch;
     debug_decl(strlcpy_unescape, SUDOERS_DEBUG_UTIL);
 
-    while ((ch = *src++) != '\0') {
-	if (ch == '\\' && *src != '\0' && !isspace((unsigned char)*src))
+    for (;;) {
+	/* Bulk-copy up to the next backslash (or the terminating NUL). */
+	const char *esc = strchr(src, '\\');
+	size_t seg = esc != NULL ? (size_t)(esc - src) : strlen(src);
+	if (seg != 0) {
+	    if (size > 1) {
+		const size_t copied = seg < size - 1 ? seg : size - 1;
+		memcpy(dst, src, copied);
+		dst += copied;
+		size -= copied;
+	    }
+	    len += seg;
+	    src += seg;
+	}
+	if (esc == NULL)
+	    break;
+	/* An escaped non-space character is copied without the backslash. */
+	ch = *src++;
+	if (*src != '\0' && !isspace((unsigned char)*src))
 	    ch = *src++;
 	if (size > 1) {
 	    *dst++ = ch;
@@ -29,12 +29,6 @@
 
 #include "sudoers.h"
 
-#ifdef HAVE_STRLCPY
-# define cpy_default	strlcpy
-#else
-# define cpy_default	sudo_strlcpy
-#endif
-
 /*
  * Join a NULL-terminated array of strings using the specified separator
  * char.  If non-NULL, the copy function must have strlcpy-like semantics.
@@ -54,19 +48,34 @@ strvec_join(char *const argv[], char sep, size_t (*cpy)(char *, const char *, si
 	debug_return_ptr(NULL);
     }
 
-    if (cpy == NULL)
-	cpy = cpy_default;
-    for (dst = result, av = argv; *av != NULL; av++) {
-	n = cpy(dst, *av, size);
-	if (n >= size) {
-	    sudo_warnx(U_("internal error, %s overflow"), __func__);
-	    free(result);
-	    debug_return_ptr(NULL);
+    if (cpy == NULL) {
+	/* No escape processing, copy whole strings at a time. */
+	for (dst = result, av = argv; *av != NULL; av++) {
+	    n = strlen(*av);
+	    if (n >= size) {
+		sudo_warnx(U_("internal error, %s overflow"), __func__);
+		free(result);
+		debug_return_ptr(NULL);
+	    }
+	    memcpy(dst, *av, n);
+	    dst += n;
+	    size -= n;
+	    *dst++ = sep;
+	    size--;
+	}
+    } else {
+	for (dst = result, av = argv; *av != NULL; av++) {
+	    n = cpy(dst, *av, size);
+	    if (n >= size) {
+		sudo_warnx(U_("internal error, %s overflow"), __func__);
+		free(result);
+		debug_return_ptr(NULL);
+	    }
+	    dst += n;
+	    size -= n;
+	    *dst++ = sep;
+	    size--;
 	}
-	dst += n;
-	size -= n;
-	*dst++ = sep;
-	size--;
     }
     *--dst = '\0';
 
@@ -1122,6 +1122,14 @@ again:
 		    /* Rewind fp and set close on exec flag. */
 		    rewind(fp);
 		    (void) fcntl(fileno(fp), F_SETFD, 1);
+#ifdef POSIX_FADV_SEQUENTIAL
+		    /*
+		     * The lexer reads the file sequentially, let the
+		     * kernel read ahead of it on a cold cache.
+		     */
+		    (void) posix_fadvise(fileno(fp), 0, 0,
+			POSIX_FADV_SEQUENTIAL);
+#endif
 		}
 	    }
 	    break;
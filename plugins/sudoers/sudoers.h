@@ -80,33 +80,41 @@ struct group_list {
  * XXX - can we embed struct eventlog here or use it instead?
  */
 struct sudo_user {
-    struct timespec submit_time;
+    /*
+     * Fields read on every rule evaluation come first so the matching
+     * code touches as few cache lines as possible; the fields below
+     * submit_time are only used during setup or for optional features.
+     */
     struct passwd *pw;
     struct passwd *_runas_pw;
     struct group *_runas_gr;
+    struct gid_list *gid_list;
+    char *name;
+    char *host;
+    char *shost;
+    char *runhost;
+    char *srunhost;
+    char *cmnd;
+    char *cmnd_args;
+    char *cmnd_base;
     struct stat *cmnd_stat;
+    uid_t uid;
+    uid_t gid;
+    int   flags;
+    struct timespec submit_time;
     char *cwd;
-    char *name;
     char *runas_user;
     char *runas_group;
     char *path;
     char *tty;
     char *ttypath;
-    char *host;
-    char *shost;
-    char *runhost;
-    char *srunhost;
     char *runchroot;
     char *runcwd;
     char *prompt;
-    char *cmnd;
-    char *cmnd_args;
-    char *cmnd_base;
     char *cmnd_safe;
     char *cmnd_saved;
     char *class_name;
     char *krb5_ccname;
-    struct gid_list *gid_list;
     char * const * env_vars;
 #ifdef HAVE_SELINUX
     char *role;
@@ -127,12 +135,9 @@ struct sudo_user {
     int   closefrom;
     int   lines;
     int   cols;
-    int   flags;
     int   max_groups;
     int   timeout;
     mode_t umask;
-    uid_t uid;
-    uid_t gid;
     pid_t sid;
     pid_t tcpgid;
     char uuid_str[37];